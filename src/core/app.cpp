@@ -1,13 +1,18 @@
 #include "app.h"
+#include "core/dispatcher.h"
 
 #ifdef _WIN32
 #include "platforms/windows/nativeapp.h"
 using namespace yuki::platforms::windows;
-#else
-#error Not supported platform
 #endif
 
 namespace yuki {
+#ifdef _WIN32
 void App::init() { NativeApp::init(); }
 int App::run() { return NativeApp::run(); }
+#else
+// No native backend; run the main dispatcher as a headless loop.
+void App::init() {}
+int App::run() { return Dispatcher::main().run(); }
+#endif
 };  // namespace yuki
@@ -0,0 +1,258 @@
+#include "binary_logger.h"
+#include <atomic>
+#include <charconv>
+#include <cstring>
+
+namespace yuki {
+namespace {
+const char kMagic[8] = {'Y', 'U', 'K', 'I', 'L', 'O', 'G', '\0'};
+
+struct FileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t charSize;
+};
+
+struct EntryHeader {
+  std::uint16_t site;
+  std::uint16_t size;
+};
+
+struct SiteHeader {
+  std::uint16_t id;
+  std::uint16_t level;
+  std::uint32_t line;
+};
+
+template <typename T>
+T load(const unsigned char*& data) {
+  T value;
+  std::memcpy(&value, data, sizeof(value));
+  data += sizeof(value);
+  return value;
+}
+
+template <typename T>
+void appendNumber(String& text, T value) {
+  char buffer[64];
+  auto end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+  text.append(buffer, end);
+}
+
+// Appends the argument of type |type| at |data|, and moves past it. Returns
+// false if the arguments end before it.
+bool appendArgument(String& text, char type, const unsigned char*& data,
+                    const unsigned char* end) {
+  auto fits = [&data, end](std::size_t size) {
+    return static_cast<std::size_t>(end - data) >= size;
+  };
+  switch (type) {
+    case 'b':
+      if (!fits(sizeof(bool))) return false;
+      text += load<bool>(data) ? TEXT("true") : TEXT("false");
+      return true;
+    case 'i':
+      if (!fits(sizeof(std::int32_t))) return false;
+      appendNumber(text, load<std::int32_t>(data));
+      return true;
+    case 'I':
+      if (!fits(sizeof(std::int64_t))) return false;
+      appendNumber(text, load<std::int64_t>(data));
+      return true;
+    case 'u':
+      if (!fits(sizeof(std::uint32_t))) return false;
+      appendNumber(text, load<std::uint32_t>(data));
+      return true;
+    case 'U':
+      if (!fits(sizeof(std::uint64_t))) return false;
+      appendNumber(text, load<std::uint64_t>(data));
+      return true;
+    case 'f':
+      if (!fits(sizeof(float))) return false;
+      appendNumber(text, load<float>(data));
+      return true;
+    case 'd':
+      if (!fits(sizeof(double))) return false;
+      appendNumber(text, load<double>(data));
+      return true;
+    case 's': {
+      if (!fits(sizeof(std::uint16_t))) return false;
+      auto length = load<std::uint16_t>(data);
+      if (!fits(length * sizeof(Char))) return false;
+      auto size = text.size();
+      text.resize(size + length);
+      std::memcpy(&text[size], data, length * sizeof(Char));
+      data += length * sizeof(Char);
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace
+
+/*******************************************************************************
+ * class LogSite
+ ******************************************************************************/
+LogSite::LogSite(LogLevel level, const char* format, const char* file,
+                 int line, const char* types)
+    : level_(level),
+      format_(format),
+      file_(file),
+      line_(line),
+      types_(types) {
+  static std::atomic<std::uint32_t> sites{0};
+  id_ = sites.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void FormatLogRecord(String& text, LogLevel level, const char* format,
+                     const char* types, const unsigned char* arguments,
+                     std::size_t size) {
+  text = Logger::tag(level);
+  auto end = arguments + size;
+  for (auto c = format; *c; ++c) {
+    if (c[0] == '{' && c[1] == '}' && *types) {
+      if (!appendArgument(text, *types++, arguments, end)) break;
+      ++c;
+    } else {
+      // Formats are ASCII.
+      text += static_cast<Char>(*c);
+    }
+  }
+  text += TEXT('\n');
+}
+
+void ILoggerListener::write(const LogRecord& record) {
+  thread_local String text;
+  FormatLogRecord(text, record.site->level(), record.site->format(),
+                  record.site->types(), record.arguments, record.size);
+  write(StringView(text));
+}
+
+/*******************************************************************************
+ * class BinaryLoggerListener
+ ******************************************************************************/
+BinaryLoggerListener::BinaryLoggerListener(const char* path)
+    : file_(std::fopen(path, "wb")) {
+  if (!file_) return;
+  FileHeader header{{}, kVersion, sizeof(Char)};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  std::fwrite(&header, sizeof(header), 1, file_);
+}
+
+BinaryLoggerListener::~BinaryLoggerListener() {
+  if (file_) std::fclose(file_);
+}
+
+void BinaryLoggerListener::write(StringView message) {
+  // Longer records are truncated.
+  constexpr std::size_t kMaxLength =
+      (0xffff - sizeof(std::uint64_t)) / sizeof(Char);
+  auto length = message.size() < kMaxLength ? message.size() : kMaxLength;
+  auto time = BinaryLogger::now();
+  entry_.resize(sizeof(time) + length * sizeof(Char));
+  std::memcpy(entry_.data(), &time, sizeof(time));
+  std::memcpy(entry_.data() + sizeof(time), message.data(),
+              length * sizeof(Char));
+  entry(kText, entry_.data(), entry_.size());
+}
+
+void BinaryLoggerListener::write(const LogRecord& record) {
+  auto id = record.site->id();
+  if (id >= kText) return;
+  if (id >= defined_.size()) defined_.resize(id + 1);
+  if (!defined_[id]) {
+    define(*record.site);
+    defined_[id] = true;
+  }
+  entry_.resize(sizeof(record.time) + record.size);
+  std::memcpy(entry_.data(), &record.time, sizeof(record.time));
+  std::memcpy(entry_.data() + sizeof(record.time), record.arguments,
+              record.size);
+  entry(static_cast<std::uint16_t>(id), entry_.data(), entry_.size());
+}
+
+void BinaryLoggerListener::flush() {
+  if (file_) std::fflush(file_);
+}
+
+void BinaryLoggerListener::define(const LogSite& site) {
+  SiteHeader header{static_cast<std::uint16_t>(site.id()),
+                    static_cast<std::uint16_t>(site.level()),
+                    static_cast<std::uint32_t>(site.line())};
+  entry_.resize(sizeof(header));
+  std::memcpy(entry_.data(), &header, sizeof(header));
+  for (auto text : {site.types(), site.format(), site.file()}) {
+    entry_.insert(entry_.end(), text, text + std::strlen(text) + 1);
+  }
+  if (entry_.size() > 0xffff) return;
+  entry(kDefinition, entry_.data(), entry_.size());
+}
+
+void BinaryLoggerListener::entry(std::uint16_t site, const void* data,
+                                 std::size_t size) {
+  if (!file_) return;
+  EntryHeader header{site, static_cast<std::uint16_t>(size)};
+  std::fwrite(&header, sizeof(header), 1, file_);
+  std::fwrite(data, size, 1, file_);
+}
+
+/*******************************************************************************
+ * class BinaryLogReader
+ ******************************************************************************/
+BinaryLogReader::BinaryLogReader(std::FILE* file) : file_(file) {
+  FileHeader header;
+  valid_ = std::fread(&header, sizeof(header), 1, file_) == 1 &&
+           std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+           header.version == BinaryLoggerListener::kVersion &&
+           header.charSize == sizeof(Char);
+}
+
+bool BinaryLogReader::read(std::uint64_t& time, String& text) {
+  std::uint16_t id;
+  while (valid_ && readEntry(id)) {
+    const unsigned char* data = entry_.data();
+    auto end = data + entry_.size();
+    if (id == BinaryLoggerListener::kDefinition) {
+      if (entry_.size() < sizeof(SiteHeader) || end[-1] != '\0') return false;
+      auto header = load<SiteHeader>(data);
+      // A level out of range comes from a corrupt or foreign file.
+      if (header.level > static_cast<int>(LogLevel::Fatal)) return false;
+      if (header.id >= sites_.size()) sites_.resize(header.id + 1);
+      auto& site = sites_[header.id];
+      site.level = static_cast<LogLevel>(header.level);
+      site.types = reinterpret_cast<const char*>(data);
+      data += site.types.size() + 1;
+      if (data == end) return false;
+      site.format = reinterpret_cast<const char*>(data);
+      site.defined = true;
+      continue;
+    }
+    if (entry_.size() < sizeof(time)) return false;
+    time = load<std::uint64_t>(data);
+    if (id == BinaryLoggerListener::kText) {
+      text.assign(reinterpret_cast<const Char*>(data),
+                  (end - data) / sizeof(Char));
+      return true;
+    }
+    // Skips the records of a site that could not be defined.
+    if (id >= sites_.size() || !sites_[id].defined) continue;
+    auto& site = sites_[id];
+    FormatLogRecord(text, site.level, site.format.c_str(), site.types.c_str(),
+                    data, end - data);
+    return true;
+  }
+  return false;
+}
+
+bool BinaryLogReader::readEntry(std::uint16_t& site) {
+  EntryHeader header;
+  if (std::fread(&header, sizeof(header), 1, file_) != 1) return false;
+  entry_.resize(header.size);
+  if (header.size && std::fread(entry_.data(), header.size, 1, file_) != 1) {
+    return false;
+  }
+  site = header.site;
+  return true;
+}
+
+}  // namespace yuki
@@ -0,0 +1,293 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "core/logger.h"
+
+// Logs a binary record at a LogLevel, if the level is compiled in and
+// enabled. The format is a string literal where each {} stands for the next
+// argument:
+//
+//   YUKI_LOG_BINARY(Trace, "mouseMoveEvent: ({}, {})", x, y);
+//
+// Only the raw arguments and a timestamp are recorded; the text is made by
+// the listeners, on the writer thread or offline by the log decoder. The
+// arguments are only evaluated if the record is written.
+#define YUKI_LOG_BINARY(level, ...)                                          \
+  if constexpr (static_cast<int>(::yuki::LogLevel::level) <                  \
+                YUKI_LOG_MIN_LEVEL) {                                        \
+  } else if (!::yuki::Logger::isEnabled(::yuki::LogLevel::level)) {          \
+  } else                                                                     \
+    [](const char* format, const auto&... arguments) {                       \
+      static const ::yuki::LogSite site(                                     \
+          ::yuki::LogLevel::level, format, __FILE__, __LINE__,               \
+          ::yuki::LogArguments<                                              \
+              std::decay_t<decltype(arguments)>...>::kTypes);                \
+      ::yuki::BinaryLogger::write(site, arguments...);                       \
+    }(__VA_ARGS__)
+
+namespace yuki {
+/*******************************************************************************
+ * class LogSite
+ *
+ * The static description of a YUKI_LOG_BINARY statement, made once when the
+ * statement first runs. Records refer to it instead of carrying the format.
+ * The types are one character per argument:
+ *
+ *   b  bool           i  int32_t        I  int64_t       u  uint32_t
+ *   U  uint64_t       f  float          d  double        s  string
+ *
+ * A string is stored as a uint16_t count of characters and the characters.
+ ******************************************************************************/
+class LogSite {
+ public:
+  LogSite(LogLevel level, const char* format, const char* file, int line,
+          const char* types);
+  LogSite(const LogSite&) = delete;
+  LogSite& operator=(const LogSite&) = delete;
+
+  LogLevel level() const { return level_; }
+  const char* format() const { return format_; }
+  const char* file() const { return file_; }
+  int line() const { return line_; }
+  const char* types() const { return types_; }
+  // Unique in the process, starting from 1.
+  std::uint32_t id() const { return id_; }
+
+ private:
+  LogLevel level_;
+  const char* format_;
+  const char* file_;
+  int line_;
+  const char* types_;
+  std::uint32_t id_;
+};
+
+// A binary record, as seen by the listeners.
+struct LogRecord {
+  const LogSite* site;
+  // In nanoseconds of std::chrono::steady_clock.
+  std::uint64_t time;
+  // The arguments, encoded as described by site->types().
+  const unsigned char* arguments;
+  std::size_t size;
+};
+
+// Formats a record like Logger does: the tag of |level|, |format| with each
+// {} replaced by the next argument, and a newline.
+void FormatLogRecord(String& text, LogLevel level, const char* format,
+                     const char* types, const unsigned char* arguments,
+                     std::size_t size);
+
+/*******************************************************************************
+ * struct LogArgument
+ *
+ * How YUKI_LOG_BINARY stores an argument of type T: its type character, the
+ * most bytes it takes, and encode(), which writes it and returns its size.
+ ******************************************************************************/
+template <typename T, typename = void>
+struct LogArgument {
+  static_assert(sizeof(T) == 0, "Unsupported YUKI_LOG_BINARY argument type");
+};
+
+template <typename T>
+struct LogScalarArgument {
+  static constexpr std::size_t kMaxSize = sizeof(T);
+  static std::size_t encode(unsigned char* out, T value) {
+    std::memcpy(out, &value, sizeof(value));
+    return sizeof(value);
+  }
+};
+
+template <>
+struct LogArgument<bool> : LogScalarArgument<bool> {
+  static constexpr char kType = 'b';
+};
+
+template <typename T>
+struct LogArgument<
+    T, std::enable_if_t<std::is_integral<T>::value &&
+                        !std::is_same<T, bool>::value &&
+                        !std::is_same<T, Char>::value>>
+    : LogScalarArgument<std::conditional_t<
+          std::is_signed<T>::value,
+          std::conditional_t<sizeof(T) <= 4, std::int32_t, std::int64_t>,
+          std::conditional_t<sizeof(T) <= 4, std::uint32_t, std::uint64_t>>> {
+  static constexpr char kType = std::is_signed<T>::value
+                                    ? (sizeof(T) <= 4 ? 'i' : 'I')
+                                    : (sizeof(T) <= 4 ? 'u' : 'U');
+};
+
+template <>
+struct LogArgument<float> : LogScalarArgument<float> {
+  static constexpr char kType = 'f';
+};
+
+template <typename T>
+struct LogArgument<T, std::enable_if_t<std::is_same<T, double>::value ||
+                                       std::is_same<T, long double>::value>>
+    : LogScalarArgument<double> {
+  static constexpr char kType = 'd';
+};
+
+struct LogStringArgument {
+  static constexpr char kType = 's';
+  // Longer strings are truncated.
+  static constexpr std::size_t kMaxLength = 128;
+  static constexpr std::size_t kMaxSize =
+      sizeof(std::uint16_t) + kMaxLength * sizeof(Char);
+  static std::size_t encode(unsigned char* out, StringView value) {
+    auto length = static_cast<std::uint16_t>(
+        value.size() < kMaxLength ? value.size() : kMaxLength);
+    std::memcpy(out, &length, sizeof(length));
+    std::memcpy(out + sizeof(length), value.data(), length * sizeof(Char));
+    return sizeof(length) + length * sizeof(Char);
+  }
+};
+
+template <>
+struct LogArgument<Char> : LogStringArgument {
+  static std::size_t encode(unsigned char* out, Char value) {
+    return LogStringArgument::encode(out, StringView(&value, 1));
+  }
+};
+template <>
+struct LogArgument<const Char*> : LogStringArgument {};
+template <>
+struct LogArgument<Char*> : LogStringArgument {};
+template <>
+struct LogArgument<String> : LogStringArgument {};
+template <>
+struct LogArgument<StringView> : LogStringArgument {};
+
+template <typename... Args>
+struct LogArguments {
+  static constexpr char kTypes[] = {LogArgument<Args>::kType..., '\0'};
+  static constexpr std::size_t kMaxSize =
+      (std::size_t{0} + ... + LogArgument<Args>::kMaxSize);
+};
+
+/*******************************************************************************
+ * class BinaryLogger
+ *
+ * Writes the records of YUKI_LOG_BINARY. A record goes through the same
+ * per-thread buffers as a text one, so it costs a copy of its arguments and
+ * a timestamp on the logging thread. The listeners get it as a LogRecord;
+ * text listeners format it on the writer thread.
+ ******************************************************************************/
+class BinaryLogger {
+ public:
+  // The largest record, with its site and timestamp.
+  static constexpr std::size_t kMaxSize = 4096;
+
+  template <typename... Args>
+  static void write(const LogSite& site, const Args&... args) {
+    constexpr auto size =
+        kHeaderSize + LogArguments<std::decay_t<Args>...>::kMaxSize;
+    static_assert(size <= kMaxSize, "Too many YUKI_LOG_BINARY arguments");
+    unsigned char record[size];
+    auto pointer = &site;
+    auto time = now();
+    std::memcpy(record, &pointer, sizeof(pointer));
+    std::memcpy(record + sizeof(pointer), &time, sizeof(time));
+    std::size_t length = kHeaderSize;
+    ((length += LogArgument<std::decay_t<Args>>::encode(record + length, args)),
+     ...);
+    submit(record, length);
+  }
+
+  static std::uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+ private:
+  // The site pointer and the timestamp.
+  static constexpr std::size_t kHeaderSize =
+      sizeof(const LogSite*) + sizeof(std::uint64_t);
+
+  // Defined with the text path, whose buffers it shares.
+  static void submit(const unsigned char* record, std::size_t size);
+};
+
+/*******************************************************************************
+ * class BinaryLoggerListener
+ *
+ * Writes records to a binary log file, which the log decoder turns back into
+ * text. The file is a header, then entries:
+ *
+ *   header  "YUKILOG" '\0', uint32_t version, uint32_t sizeof(Char)
+ *   entry   uint16_t site, uint16_t size, |size| bytes
+ *
+ * Site 0 defines a site before its first record: uint16_t id, uint16_t level,
+ * uint32_t line, then the types, the format and the file, each followed by a
+ * null character. Site 0xffff is a text record: uint64_t time, then the
+ * characters of the line. Any other entry is a record of that site: uint64_t
+ * time, then the arguments. Records of sites past 0xfffe are not written.
+ ******************************************************************************/
+class BinaryLoggerListener : public ILoggerListener {
+ public:
+  static constexpr std::uint32_t kVersion = 1;
+  static constexpr std::uint16_t kDefinition = 0;
+  static constexpr std::uint16_t kText = 0xffff;
+
+  explicit BinaryLoggerListener(const char* path);
+  BinaryLoggerListener(const BinaryLoggerListener&) = delete;
+  BinaryLoggerListener& operator=(const BinaryLoggerListener&) = delete;
+  ~BinaryLoggerListener() override;
+
+  bool isOpen() const { return file_ != nullptr; }
+
+  void write(StringView message) override;
+  void write(const LogRecord& record) override;
+  void flush() override;
+
+ private:
+  void define(const LogSite& site);
+  void entry(std::uint16_t site, const void* data, std::size_t size);
+
+  std::FILE* file_;
+  // Indexed by site id.
+  std::vector<bool> defined_;
+  std::vector<unsigned char> entry_;
+};
+
+/*******************************************************************************
+ * class BinaryLogReader
+ *
+ * Reads back the records of a binary log file, formatted as text.
+ ******************************************************************************/
+class BinaryLogReader {
+ public:
+  // Does not take ownership of |file|.
+  explicit BinaryLogReader(std::FILE* file);
+
+  // Whether the file has a header this version can read.
+  bool isValid() const { return valid_; }
+  // Reads the next record; false at the end of the file, or at an entry cut
+  // short, as the last one of a log whose process crashed.
+  bool read(std::uint64_t& time, String& text);
+
+ private:
+  struct Site {
+    bool defined = false;
+    LogLevel level = LogLevel::Info;
+    std::string types;
+    std::string format;
+  };
+
+  bool readEntry(std::uint16_t& site);
+
+  std::FILE* file_;
+  bool valid_ = false;
+  std::vector<Site> sites_;
+  std::vector<unsigned char> entry_;
+};
+
+}  // namespace yuki
@@ -0,0 +1,572 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <set>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "core/observable_collection.h"
+#include "core/property.h"
+
+namespace yuki {
+
+/*******************************************************************************
+ * class CollectionView
+ *
+ * The base of the collections derived from another observable collection.
+ * A view applies the deltas of its source to its own state and reports the
+ * resulting edits as one notification per source notification, so views can
+ * be stacked and observed like any ObservableCollection.
+ *
+ * A source is any ObservableCollection with value_type, size() and
+ * operator[]. Views keep pending elements as value-initialized placeholders,
+ * so their value types must be default constructible.
+ ******************************************************************************/
+template <typename Source>
+class CollectionView : public ObservableCollection,
+                       protected CollectionObserver {
+ public:
+  using size_type = std::size_t;
+
+  Source& source() const { return source_; }
+
+ protected:
+  explicit CollectionView(Source& source) : source_(source) {}
+
+  void sourceChanged(const std::vector<CollectionChange>& changes) override {
+    batch([this, &changes] { CollectionObserver::sourceChanged(changes); });
+  }
+
+  Source& source_;
+};
+
+/*******************************************************************************
+ * class MappedView
+ *
+ * view[i] == map(source[i]). Only inserted and replaced elements are mapped;
+ * the deltas are forwarded unchanged.
+ ******************************************************************************/
+template <typename Source, typename Map>
+class MappedView : public CollectionView<Source> {
+ public:
+  using value_type = std::decay_t<std::invoke_result_t<
+      Map&, const typename Source::value_type&>>;
+  using size_type = std::size_t;
+
+  MappedView(Source& source, Map map)
+      : CollectionView<Source>(source), map_(std::move(map)) {
+    this->observe(source);
+  }
+
+  size_type size() const { return values_.size(); }
+  bool empty() const { return values_.empty(); }
+  const value_type& operator[](size_type index) const {
+    return values_[index];
+  }
+
+ protected:
+  void sourceInserted(size_type offset, size_type count) override {
+    values_.insert(values_.begin() + offset, count, value_type{});
+    pending_.insert(pending_.begin() + offset, count, true);
+    this->record({CollectionChange::kInsert, offset, count});
+  }
+  void sourceErased(size_type offset, size_type count) override {
+    values_.erase(values_.begin() + offset, values_.begin() + offset + count);
+    pending_.erase(pending_.begin() + offset,
+                   pending_.begin() + offset + count);
+    this->record({CollectionChange::kErase, offset, count});
+  }
+  void sourceReplaced(size_type offset, size_type count) override {
+    std::fill_n(pending_.begin() + offset, count, true);
+    this->record({CollectionChange::kReplace, offset, count});
+  }
+  void sourceMoved(size_type offset, size_type count,
+                   size_type destination) override {
+    moveRange(values_, offset, count, destination);
+    moveRange(pending_, offset, count, destination);
+    this->record({CollectionChange::kMove, offset, count, destination});
+  }
+  void sourceSettled(size_type first, size_type last) override {
+    for (auto i = first; i < last; ++i) {
+      if (pending_[i]) {
+        values_[i] = map_(this->source_[i]);
+        pending_[i] = false;
+      }
+    }
+  }
+
+ private:
+  Map map_;
+  std::vector<value_type> values_;
+  std::vector<bool> pending_;
+};
+
+/*******************************************************************************
+ * class FilteredView
+ *
+ * The elements of the source that satisfy |predicate|, in source order. The
+ * predicate is only evaluated for inserted and replaced elements; an element
+ * that stops or starts to satisfy it is erased or inserted.
+ *
+ * The settled part of a notification is rebuilt in one pass and spliced back,
+ * so a batch of k edits costs k predicate calls and a single shift of the
+ * elements after it, not one shift per element.
+ ******************************************************************************/
+template <typename Source, typename Predicate>
+class FilteredView : public CollectionView<Source> {
+ public:
+  using value_type = typename Source::value_type;
+  using size_type = std::size_t;
+
+  FilteredView(Source& source, Predicate predicate)
+      : CollectionView<Source>(source), predicate_(std::move(predicate)) {
+    this->observe(source);
+  }
+
+  size_type size() const { return indices_.size(); }
+  bool empty() const { return indices_.empty(); }
+  decltype(auto) operator[](size_type index) const {
+    return this->source_[indices_[index]];
+  }
+  // The position in the source of the element at |index|.
+  size_type sourceIndex(size_type index) const { return indices_[index]; }
+
+ protected:
+  void sourceInserted(size_type offset, size_type count) override {
+    states_.insert(states_.begin() + offset, count, kPending);
+    shift(rank(offset), count);
+  }
+  void sourceErased(size_type offset, size_type count) override {
+    auto first = rank(offset);
+    auto last = rank(offset + count);
+    indices_.erase(indices_.begin() + first, indices_.begin() + last);
+    states_.erase(states_.begin() + offset, states_.begin() + offset + count);
+    shift(first, 0 - count);
+    if (last > first) {
+      this->record({CollectionChange::kErase, first, last - first});
+    }
+  }
+  void sourceReplaced(size_type offset, size_type count) override {
+    for (auto i = offset; i < offset + count; ++i) {
+      if (states_[i] == kPassed) {
+        states_[i] = kPendingPassed;
+      } else if (states_[i] == kFailed) {
+        states_[i] = kPending;
+      }
+    }
+  }
+  void sourceMoved(size_type offset, size_type count,
+                   size_type destination) override {
+    auto first = rank(offset);
+    auto last = rank(offset + count);
+    std::vector<size_type> moved(indices_.begin() + first,
+                                 indices_.begin() + last);
+    indices_.erase(indices_.begin() + first, indices_.begin() + last);
+    shift(first, 0 - count);
+    auto target = rank(destination);
+    shift(target, count);
+    for (auto& index : moved) {
+      index = index - offset + destination;
+    }
+    indices_.insert(indices_.begin() + target, moved.begin(), moved.end());
+    moveRange(states_, offset, count, destination);
+    if (!moved.empty() && first != target) {
+      this->record(
+          {CollectionChange::kMove, first, moved.size(), target});
+    }
+  }
+  void sourceSettled(size_type first, size_type last) override {
+    auto begin = rank(first);
+    auto end = rank(last);
+    settled_.clear();
+    for (auto i = first; i < last; ++i) {
+      auto state = states_[i];
+      if (state == kPassed) {
+        settled_.push_back(i);
+        continue;
+      }
+      if (state == kFailed) continue;
+      bool passed = predicate_(this->source_[i]);
+      states_[i] = passed ? kPassed : kFailed;
+      // The view so far is the settled prefix followed by the old elements
+      // not visited yet.
+      auto position = begin + settled_.size();
+      if (state == kPendingPassed) {
+        this->record({passed ? CollectionChange::kReplace
+                             : CollectionChange::kErase,
+                      position, 1});
+      } else if (passed) {
+        this->record({CollectionChange::kInsert, position, 1});
+      }
+      if (passed) settled_.push_back(i);
+    }
+    if (settled_.size() > end - begin) {
+      indices_.insert(indices_.begin() + end, settled_.size() - (end - begin),
+                      0);
+    } else {
+      indices_.erase(indices_.begin() + begin + settled_.size(),
+                     indices_.begin() + end);
+    }
+    std::copy(settled_.begin(), settled_.end(), indices_.begin() + begin);
+  }
+
+ private:
+  enum State : std::uint8_t { kFailed, kPassed, kPending, kPendingPassed };
+
+  // The number of elements in the view that come before source[index].
+  size_type rank(size_type index) const {
+    return std::lower_bound(indices_.begin(), indices_.end(), index) -
+           indices_.begin();
+  }
+  // Adds |delta| (modulo 2^N) to the source positions from indices_[first].
+  void shift(size_type first, size_type delta) {
+    for (auto i = first; i < indices_.size(); ++i) {
+      indices_[i] += delta;
+    }
+  }
+
+  Predicate predicate_;
+  // The source positions of the elements in the view, sorted.
+  std::vector<size_type> indices_;
+  std::vector<State> states_;
+  // Scratch space of sourceSettled(), kept for its capacity.
+  std::vector<size_type> settled_;
+};
+
+/*******************************************************************************
+ * class SortedView
+ *
+ * The elements of the source ordered by |compare|. Equivalent elements keep
+ * the order in which they were inserted into the source. Moves in the source
+ * do not change the view.
+ *
+ * The view keeps a copy of each element in source order as well, to find it
+ * again once the source has erased or replaced it.
+ *
+ * A notification that leaves a few elements to place inserts each with a
+ * binary search and a shift. Past kMergeThreshold, the new and replaced
+ * elements are sorted on their own and merged with the view in one pass, so
+ * building the view or appending a batch of k rows to n costs
+ * O(n + k log k) rather than k shifts of the whole view. Replaced elements
+ * are then reported as erased and inserted.
+ ******************************************************************************/
+template <typename Source,
+          typename Compare = std::less<typename Source::value_type>>
+class SortedView : public CollectionView<Source> {
+ public:
+  using value_type = typename Source::value_type;
+  using size_type = std::size_t;
+
+  static constexpr size_type kMergeThreshold = 16;
+
+  explicit SortedView(Source& source, Compare compare = Compare())
+      : CollectionView<Source>(source), compare_(std::move(compare)) {
+    this->observe(source);
+  }
+
+  size_type size() const { return sorted_.size(); }
+  bool empty() const { return sorted_.empty(); }
+  const value_type& operator[](size_type index) const {
+    return sorted_[index].value;
+  }
+
+ protected:
+  void sourceInserted(size_type offset, size_type count) override {
+    slots_.insert(slots_.begin() + offset, count, Slot());
+  }
+  void sourceErased(size_type offset, size_type count) override {
+    for (auto i = offset; i < offset + count; ++i) {
+      if (slots_[i].state == kPending) continue;
+      auto position = find(slots_[i].entry);
+      sorted_.erase(sorted_.begin() + position);
+      this->record({CollectionChange::kErase, position, 1});
+    }
+    slots_.erase(slots_.begin() + offset, slots_.begin() + offset + count);
+  }
+  void sourceReplaced(size_type offset, size_type count) override {
+    for (auto i = offset; i < offset + count; ++i) {
+      if (slots_[i].state == kSorted) slots_[i].state = kPendingSorted;
+    }
+  }
+  void sourceMoved(size_type offset, size_type count,
+                   size_type destination) override {
+    moveRange(slots_, offset, count, destination);
+  }
+  void sourceSettled(size_type first, size_type last) override {
+    size_type pending = 0;
+    for (auto i = first; i < last; ++i) {
+      if (slots_[i].state != kSorted) ++pending;
+    }
+    if (pending >= kMergeThreshold) {
+      merge(first, last);
+      return;
+    }
+    for (auto i = first; i < last; ++i) {
+      auto& slot = slots_[i];
+      if (slot.state == kSorted) continue;
+      if (slot.state == kPendingSorted) {
+        auto position = find(slot.entry);
+        sorted_.erase(sorted_.begin() + position);
+        slot.entry.value = this->source_[i];
+        auto destination = find(slot.entry);
+        sorted_.insert(sorted_.begin() + destination, slot.entry);
+        if (destination != position) {
+          this->record({CollectionChange::kMove, position, 1, destination});
+        }
+        this->record({CollectionChange::kReplace, destination, 1});
+      } else {
+        slot.entry = {this->source_[i], nextId_++};
+        auto position = find(slot.entry);
+        sorted_.insert(sorted_.begin() + position, slot.entry);
+        this->record({CollectionChange::kInsert, position, 1});
+      }
+      slot.state = kSorted;
+    }
+  }
+
+ private:
+  enum State : std::uint8_t { kPending, kPendingSorted, kSorted };
+  struct Entry {
+    value_type value{};
+    // Orders equivalent elements by arrival.
+    std::uint64_t id = 0;
+  };
+  struct Slot {
+    Entry entry;
+    State state = kPending;
+  };
+
+  bool less(const Entry& a, const Entry& b) const {
+    if (compare_(a.value, b.value)) return true;
+    if (compare_(b.value, a.value)) return false;
+    return a.id < b.id;
+  }
+  size_type find(const Entry& entry) const {
+    return std::lower_bound(sorted_.begin(), sorted_.end(), entry,
+                            [this](const Entry& a, const Entry& b) {
+                              return less(a, b);
+                            }) -
+           sorted_.begin();
+  }
+
+  // Places the pending elements of [first, last) with one sort of their own
+  // and one merge pass over the view.
+  void merge(size_type first, size_type last) {
+    std::vector<Entry> removed;
+    std::vector<Entry> added;
+    for (auto i = first; i < last; ++i) {
+      auto& slot = slots_[i];
+      if (slot.state == kSorted) continue;
+      if (slot.state == kPendingSorted) {
+        removed.push_back(slot.entry);
+        slot.entry.value = this->source_[i];
+      } else {
+        slot.entry = {this->source_[i], nextId_++};
+      }
+      added.push_back(slot.entry);
+      slot.state = kSorted;
+    }
+    auto byOrder = [this](const Entry& a, const Entry& b) {
+      return less(a, b);
+    };
+    std::sort(removed.begin(), removed.end(), byOrder);
+    std::sort(added.begin(), added.end(), byOrder);
+
+    // The view so far is |merged| followed by the old entries from |cursor|
+    // on, so every change is recorded at the end of |merged|. The runs of
+    // old entries between two changes are found by binary search and moved
+    // as a block.
+    std::vector<Entry> merged;
+    merged.reserve(sorted_.size() - removed.size() + added.size());
+    auto cursor = sorted_.begin();
+    auto moveUpTo = [this, &merged, &cursor, &byOrder](const Entry& entry) {
+      auto stop = std::lower_bound(cursor, sorted_.end(), entry, byOrder);
+      merged.insert(merged.end(), std::make_move_iterator(cursor),
+                    std::make_move_iterator(stop));
+      cursor = stop;
+    };
+    auto nextRemoved = removed.begin();
+    auto nextAdded = added.begin();
+    while (nextRemoved != removed.end() || nextAdded != added.end()) {
+      if (nextAdded == added.end() ||
+          (nextRemoved != removed.end() && !less(*nextAdded, *nextRemoved))) {
+        // Ids are unique, so this finds the old entry itself.
+        moveUpTo(*nextRemoved);
+        if (cursor != sorted_.end() && cursor->id == nextRemoved->id) {
+          this->record({CollectionChange::kErase, merged.size(), 1});
+          ++cursor;
+        }
+        ++nextRemoved;
+      } else {
+        moveUpTo(*nextAdded);
+        this->record({CollectionChange::kInsert, merged.size(), 1});
+        merged.push_back(std::move(*nextAdded++));
+      }
+    }
+    merged.insert(merged.end(), std::make_move_iterator(cursor),
+                  std::make_move_iterator(sorted_.end()));
+    sorted_.swap(merged);
+  }
+
+  Compare compare_;
+  std::vector<Entry> sorted_;
+  std::vector<Slot> slots_;
+  std::uint64_t nextId_ = 0;
+};
+
+/*******************************************************************************
+ * class AggregateView
+ *
+ * Folds the elements of the source into value(), a Property that can be bound
+ * to. |Aggregate| is updated with add() and remove() for each inserted, erased
+ * and replaced element and read with result(); see Sum, Count and Extremum.
+ ******************************************************************************/
+template <typename Source, typename Aggregate>
+class AggregateView : public Object, protected CollectionObserver {
+ public:
+  using value_type =
+      std::decay_t<decltype(std::declval<const Aggregate&>().result())>;
+  using size_type = std::size_t;
+
+  explicit AggregateView(Source& source, Aggregate aggregate = Aggregate())
+      : source_(source), aggregate_(std::move(aggregate)) {
+    observe(source);
+  }
+
+  Property<value_type>& value() { return value_; }
+  value_type get() const { return value_.get(); }
+
+ protected:
+  void sourceInserted(size_type offset, size_type count) override {
+    slots_.insert(slots_.begin() + offset, count, Slot());
+  }
+  void sourceErased(size_type offset, size_type count) override {
+    for (auto i = offset; i < offset + count; ++i) {
+      if (!slots_[i].pending) aggregate_.remove(slots_[i].value);
+    }
+    slots_.erase(slots_.begin() + offset, slots_.begin() + offset + count);
+  }
+  void sourceReplaced(size_type offset, size_type count) override {
+    for (auto i = offset; i < offset + count; ++i) {
+      if (!slots_[i].pending) {
+        aggregate_.remove(slots_[i].value);
+        slots_[i].pending = true;
+      }
+    }
+  }
+  void sourceMoved(size_type offset, size_type count,
+                   size_type destination) override {
+    moveRange(slots_, offset, count, destination);
+  }
+  void sourceSettled(size_type first, size_type last) override {
+    for (auto i = first; i < last; ++i) {
+      if (slots_[i].pending) {
+        slots_[i].value = source_[i];
+        slots_[i].pending = false;
+        aggregate_.add(slots_[i].value);
+      }
+    }
+    value_ = aggregate_.result();
+  }
+
+ private:
+  struct Slot {
+    typename Source::value_type value{};
+    bool pending = true;
+  };
+
+  Source& source_;
+  Aggregate aggregate_;
+  std::vector<Slot> slots_;
+  Property<value_type> value_;
+};
+
+template <typename T>
+class Sum {
+ public:
+  void add(const T& value) { sum_ += value; }
+  void remove(const T& value) { sum_ -= value; }
+  T result() const { return sum_; }
+
+ private:
+  T sum_{};
+};
+
+template <typename T, typename Predicate>
+class Count {
+ public:
+  explicit Count(Predicate predicate) : predicate_(std::move(predicate)) {}
+  void add(const T& value) { count_ += predicate_(value) ? 1 : 0; }
+  void remove(const T& value) { count_ -= predicate_(value) ? 1 : 0; }
+  std::size_t result() const { return count_; }
+
+ private:
+  Predicate predicate_;
+  std::size_t count_ = 0;
+};
+
+// The first element in |Compare| order, or T() if there is none. Values the
+// comparator does not order strictly, such as NaN, may not be found again on
+// removal; they are then left in place rather than erasing end().
+template <typename T, typename Compare>
+class Extremum {
+ public:
+  void add(const T& value) { values_.insert(value); }
+  void remove(const T& value) {
+    auto it = values_.find(value);
+    if (it != values_.end()) values_.erase(it);
+  }
+  T result() const { return values_.empty() ? T() : *values_.begin(); }
+
+ private:
+  std::multiset<T, Compare> values_;
+};
+
+template <typename Source>
+class SumView
+    : public AggregateView<Source, Sum<typename Source::value_type>> {
+ public:
+  explicit SumView(Source& source)
+      : AggregateView<Source, Sum<typename Source::value_type>>(source) {}
+};
+
+template <typename Source, typename Predicate>
+class CountView : public AggregateView<
+                      Source, Count<typename Source::value_type, Predicate>> {
+ public:
+  CountView(Source& source, Predicate predicate)
+      : AggregateView<Source, Count<typename Source::value_type, Predicate>>(
+            source, Count<typename Source::value_type, Predicate>(
+                        std::move(predicate))) {}
+};
+
+template <typename Source>
+class MinView
+    : public AggregateView<Source,
+                           Extremum<typename Source::value_type,
+                                    std::less<typename Source::value_type>>> {
+ public:
+  explicit MinView(Source& source)
+      : AggregateView<Source,
+                      Extremum<typename Source::value_type,
+                               std::less<typename Source::value_type>>>(
+            source) {}
+};
+
+template <typename Source>
+class MaxView
+    : public AggregateView<
+          Source, Extremum<typename Source::value_type,
+                           std::greater<typename Source::value_type>>> {
+ public:
+  explicit MaxView(Source& source)
+      : AggregateView<Source,
+                      Extremum<typename Source::value_type,
+                               std::greater<typename Source::value_type>>>(
+            source) {}
+};
+
+}  // namespace yuki
@@ -0,0 +1,158 @@
+#include "dispatcher.h"
+#include "core/thread_safe_property.h"
+
+namespace yuki {
+/*******************************************************************************
+ * class Dispatcher::Queue
+ *
+ * Vyukov's intrusive MPSC queue, as PropertyUpdateQueue, with an instance per
+ * priority. |head_| is written by the producers and |tail_| by the consumer,
+ * so they are kept on separate cache lines.
+ ******************************************************************************/
+struct Dispatcher::Node {
+  std::atomic<Node*> next{nullptr};
+  Task task;
+};
+
+class Dispatcher::Queue {
+ public:
+  Queue() : head_(&stub_), tail_(&stub_) {}
+  Queue(const Queue&) = delete;
+  Queue& operator=(const Queue&) = delete;
+  ~Queue() {
+    while (auto node = pop()) {
+      delete node;
+    }
+  }
+
+  void push(Node* node);
+  // Returns null if the queue is empty or a producer is halfway through a
+  // push; see empty() to tell the two apart.
+  Node* pop();
+  bool empty() const {
+    return tail_ == &stub_ && !stub_.next.load(std::memory_order_acquire) &&
+           head_.load(std::memory_order_acquire) == &stub_;
+  }
+
+ private:
+  Node stub_;
+  alignas(64) std::atomic<Node*> head_;
+  alignas(64) Node* tail_;
+};
+
+void Dispatcher::Queue::push(Node* node) {
+  node->next.store(nullptr, std::memory_order_relaxed);
+  auto previous = head_.exchange(node, std::memory_order_acq_rel);
+  previous->next.store(node, std::memory_order_release);
+}
+
+Dispatcher::Node* Dispatcher::Queue::pop() {
+  auto node = tail_;
+  auto next = node->next.load(std::memory_order_acquire);
+  if (node == &stub_) {
+    if (!next) return nullptr;
+    tail_ = next;
+    node = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if (next) {
+    tail_ = next;
+    return node;
+  }
+  if (node != head_.load(std::memory_order_acquire)) return nullptr;
+  push(&stub_);
+  next = node->next.load(std::memory_order_acquire);
+  if (next) {
+    tail_ = next;
+    return node;
+  }
+  return nullptr;
+}
+
+/*******************************************************************************
+ * class Dispatcher
+ ******************************************************************************/
+Dispatcher::Dispatcher() : queues_(new Queue[kPriorities]) {}
+
+Dispatcher::~Dispatcher() = default;
+
+Dispatcher& Dispatcher::main() {
+  static Dispatcher dispatcher;
+  return dispatcher;
+}
+
+void Dispatcher::post(Task task, DispatchPriority priority) {
+  auto node = new Node;
+  node->task = std::move(task);
+  queues_[static_cast<std::size_t>(priority)].push(node);
+  signal();
+}
+
+void Dispatcher::signal() {
+  if (!signaled_.exchange(true)) wake();
+}
+
+void Dispatcher::quit(int exitCode) {
+  exitCode_.store(exitCode);
+  quitting_.store(true);
+  wake();
+}
+
+bool Dispatcher::takeQuit(int& exitCode) {
+  if (!quitting_.exchange(false)) return false;
+  exitCode = exitCode_.load();
+  return true;
+}
+
+bool Dispatcher::drain(std::size_t budget) {
+  // Cleared before looking at the queues: a post that the drain misses
+  // signals again.
+  signaled_.store(false);
+  for (std::size_t i = 0; i < budget; ++i) {
+    Node* node = nullptr;
+    for (std::size_t priority = 0; !node && priority < kPriorities;
+         ++priority) {
+      node = queues_[priority].pop();
+    }
+    if (!node) break;
+    std::unique_ptr<Node> owner(node);
+    node->task();
+  }
+  if (empty()) return false;
+  signal();
+  return true;
+}
+
+bool Dispatcher::empty() const {
+  for (std::size_t priority = 0; priority < kPriorities; ++priority) {
+    if (!queues_[priority].empty()) return false;
+  }
+  return true;
+}
+
+int Dispatcher::run() {
+  for (;;) {
+    drain();
+    // Property updates belong to the UI thread; a dispatcher run on another
+    // thread must leave them alone.
+    if (this == &main()) PropertyUpdate::applyPending();
+    int exitCode;
+    if (takeQuit(exitCode)) return exitCode;
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock,
+                    [this] { return signaled_.load() || quitting_.load(); });
+  }
+}
+
+void Dispatcher::wake() {
+  if (wake_) {
+    wake_();
+    return;
+  }
+  // Taking the lock orders the notification after a check of the predicate
+  // in run(), so it cannot be lost.
+  std::lock_guard<std::mutex> lock(mutex_);
+  condition_.notify_one();
+}
+
+}  // namespace yuki
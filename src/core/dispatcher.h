@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include "core/event.h"
+#include "core/function.h"
+
+namespace yuki {
+
+// The order in which posted work runs; lower values first.
+enum class DispatchPriority { Input, Render, Background, Idle };
+
+/*******************************************************************************
+ * class Dispatcher
+ *
+ * Runs closures posted from any thread on the thread that drains it, usually
+ * the UI thread. Each priority has its own lock-free multi-producer
+ * single-consumer queue. drain() always takes the next task from the most
+ * urgent non-empty queue, so input posted while background work is running
+ * jumps ahead of it. Idle tasks run only when nothing else is queued.
+ *
+ * A drain runs at most a batch of tasks, then returns so that the message
+ * loop can handle native messages between batches. When a post makes the
+ * queues non-empty, the dispatcher calls its wake handler, which makes the
+ * native loop call drain() soon. ThreadSafeProperty posts signal the main
+ * dispatcher the same way. Without a wake handler, run() is a headless
+ * loop that sleeps until something is posted, so tests and tools get a loop
+ * without any window system.
+ ******************************************************************************/
+class Dispatcher {
+ public:
+  using Task = InlineFunction<void()>;
+  using WakeHandler = InlineFunction<void()>;
+
+  static constexpr std::size_t kBatchSize = 64;
+
+  Dispatcher();
+  Dispatcher(const Dispatcher&) = delete;
+  Dispatcher& operator=(const Dispatcher&) = delete;
+  // Drops the tasks that never ran. Producers must stop posting first.
+  ~Dispatcher();
+
+  // The dispatcher of the UI thread, drained by App::run().
+  static Dispatcher& main();
+
+  // Thread-safe.
+  void post(Task task,
+            DispatchPriority priority = DispatchPriority::Background);
+  // Fires |event| with copies of |args| on the draining thread. The event
+  // must outlive the call. Thread-safe.
+  template <typename R, typename... Args, typename... Values>
+  void fire(DispatchPriority priority, Event<R(Args...)>& event,
+            Values&&... args) {
+    post(
+        [&event, args = std::make_tuple(std::forward<Values>(args)...)] {
+          std::apply([&event](const auto&... args) { event.fire(args...); },
+                     args);
+        },
+        priority);
+  }
+  // Makes the draining thread look at its queues and at pending property
+  // updates soon, waking it if it is idle. Thread-safe.
+  void signal();
+  // Makes run(), or the native message loop, return |exitCode| after the
+  // current batch. Thread-safe.
+  void quit(int exitCode = 0);
+  // Whether quit() has been called since the last check; if so, stores its
+  // exit code. For native loops that call drain() themselves.
+  bool takeQuit(int& exitCode);
+
+  // Runs up to |budget| tasks on the calling thread, which must be the only
+  // one draining. Returns whether tasks remain, in which case the wake
+  // handler has been called again.
+  bool drain(std::size_t budget = kBatchSize);
+  bool empty() const;
+
+  // Called, possibly from a producer thread, when a post finds the
+  // dispatcher idle. Set it before anything is posted.
+  void setWakeHandler(WakeHandler handler) { wake_ = std::move(handler); }
+  // Drains the dispatcher until quit(), sleeping while it is empty. The main
+  // dispatcher also applies pending property updates after each drain.
+  int run();
+
+ private:
+  struct Node;
+  class Queue;
+  static constexpr std::size_t kPriorities = 4;
+
+  void wake();
+
+  std::unique_ptr<Queue[]> queues_;
+  // Set by the first post since the last drain started; only that post
+  // wakes the consumer.
+  std::atomic<bool> signaled_{false};
+  std::atomic<bool> quitting_{false};
+  std::atomic<int> exitCode_{0};
+  WakeHandler wake_;
+  // Only used to put run() to sleep; posting never takes the lock unless
+  // it has to wake the headless loop.
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
+
+}  // namespace yuki
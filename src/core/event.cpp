@@ -0,0 +1,119 @@
+#include "event.h"
+
+namespace yuki {
+/*******************************************************************************
+ * class EventConnection
+ ******************************************************************************/
+bool EventConnection::connected() const {
+  return event_ && *event_ && (*event_)->connected(slot_, generation_);
+}
+
+void EventConnection::disconnect() {
+  if (event_ && *event_) (*event_)->disconnect(slot_, generation_);
+  event_.reset();
+}
+
+/*******************************************************************************
+ * class EventBase
+ ******************************************************************************/
+EventBase::~EventBase() {
+  if (self_) *self_ = nullptr;
+  for (auto lifetime : lifetimes_) {
+    if (lifetime) lifetime->release();
+  }
+}
+
+EventConnection EventBase::connect(ObjectLifetime* lifetime) {
+  if (!self_) self_ = std::make_shared<EventBase*>(this);
+  auto slot = free_;
+  if (slot == kNone) {
+    slot = static_cast<std::uint32_t>(slots_.size());
+    slots_.push_back({0, 0});
+  } else {
+    free_ = slots_[slot].index;
+  }
+  slots_[slot].index = static_cast<std::uint32_t>(owners_.size());
+  owners_.push_back(slot);
+  lifetimes_.push_back(lifetime);
+  if (lifetime) {
+    lifetime->retain();
+    ++tracked_;
+  }
+  if (dispatching()) dirty_ = true;
+  return EventConnection(self_, slot, slots_[slot].generation);
+}
+
+bool EventBase::connected(std::uint32_t slot,
+                          std::uint32_t generation) const {
+  if (slot >= slots_.size() || slots_[slot].generation != generation) {
+    return false;
+  }
+  auto lifetime = lifetimes_[slots_[slot].index];
+  return !lifetime || !lifetime->expired();
+}
+
+void EventBase::disconnect(std::uint32_t slot, std::uint32_t generation) {
+  if (slot >= slots_.size() || slots_[slot].generation != generation) return;
+  auto index = slots_[slot].index;
+  if (auto lifetime = lifetimes_[index]) {
+    lifetime->release();
+    lifetimes_[index] = nullptr;
+    --tracked_;
+  }
+  if (dispatching()) {
+    // The handler may be running; leave it in place until compact().
+    owners_[index] = kNone;
+    ++tombstones_;
+    dirty_ = true;
+  } else {
+    auto last = owners_.size() - 1;
+    if (index != last) {
+      moveHandler(last, index);
+      owners_[index] = owners_[last];
+      lifetimes_[index] = lifetimes_[last];
+      slots_[owners_[index]].index = index;
+    }
+    owners_.pop_back();
+    lifetimes_.pop_back();
+    truncate(last);
+  }
+  // Invalidates every connection to this slot.
+  ++slots_[slot].generation;
+  slots_[slot].index = free_;
+  free_ = slot;
+}
+
+void EventBase::compact() {
+  commit();
+  std::size_t size = 0;
+  for (std::size_t i = 0; i < owners_.size(); ++i) {
+    auto slot = owners_[i];
+    if (slot == kNone) continue;
+    if (i != size) {
+      moveHandler(i, size);
+      owners_[size] = slot;
+      lifetimes_[size] = lifetimes_[i];
+      slots_[slot].index = static_cast<std::uint32_t>(size);
+    }
+    ++size;
+  }
+  owners_.resize(size);
+  lifetimes_.resize(size);
+  truncate(size);
+  tombstones_ = 0;
+  dirty_ = false;
+}
+
+void EventBase::sweep() {
+  expirations_ = ObjectLifetime::expirations();
+  // Backwards, so that swapping the last handler into a hole is harmless.
+  for (auto i = owners_.size(); i-- > 0;) {
+    auto lifetime = lifetimes_[i];
+    if (lifetime && lifetime->expired()) {
+      auto slot = owners_[i];
+      disconnect(slot, slots_[slot].generation);
+    }
+  }
+}
+
+}  // namespace yuki
@@ -1,38 +1,249 @@
 #pragma once
-#include <algorithm>
-#include <functional>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#include "core/function.h"
 #include "core/object.h"
 
 namespace yuki {
+class EventBase;
+
+/*******************************************************************************
+ * class EventConnection
+ *
+ * Identifies one handler of an event. A connection is a slot index plus the
+ * generation of the slot when the handler was added, so a stale connection
+ * never disconnects a handler that has reused its slot. It may outlive the
+ * event, in which case disconnecting does nothing.
+ ******************************************************************************/
+class EventConnection {
+ public:
+  EventConnection() = default;
+
+  bool connected() const;
+  void disconnect();
+
+ private:
+  EventConnection(std::shared_ptr<EventBase*> event, std::uint32_t slot,
+                  std::uint32_t generation)
+      : event_(std::move(event)), slot_(slot), generation_(generation) {}
+
+  std::shared_ptr<EventBase*> event_;
+  std::uint32_t slot_ = 0;
+  std::uint32_t generation_ = 0;
+  friend class EventBase;
+};
+
+/*******************************************************************************
+ * class ScopedEventConnection
+ *
+ * Disconnects its handler when it goes out of scope.
+ ******************************************************************************/
+class ScopedEventConnection {
+ public:
+  ScopedEventConnection() = default;
+  ScopedEventConnection(EventConnection connection)
+      : connection_(std::move(connection)) {}
+  ScopedEventConnection(const ScopedEventConnection&) = delete;
+  ScopedEventConnection(ScopedEventConnection&&) = default;
+  ScopedEventConnection& operator=(const ScopedEventConnection&) = delete;
+  ScopedEventConnection& operator=(ScopedEventConnection&& other) {
+    if (this != &other) {
+      connection_.disconnect();
+      connection_ = std::move(other.connection_);
+    }
+    return *this;
+  }
+  ~ScopedEventConnection() { connection_.disconnect(); }
+
+  bool connected() const { return connection_.connected(); }
+  void disconnect() { connection_.disconnect(); }
+  // Keeps the handler connected past the end of the scope.
+  EventConnection release() { return std::move(connection_); }
+
+ private:
+  EventConnection connection_;
+};
+
+/*******************************************************************************
+ * class EventBase
+ *
+ * The slot map behind Event. Handlers are stored densely, in the order of the
+ * derived class; each one owns a slot that maps its connection to its current
+ * position. Removing a handler moves the last one into its place, so adding,
+ * removing and locating a handler are O(1), at the cost of handlers not
+ * staying in the order they were added.
+ *
+ * Handlers may add and remove handlers while the event fires, including from
+ * nested fires. The handlers being iterated never move then: a removed
+ * handler leaves a tombstone that fire() skips, and an added one is set
+ * aside. Both are resolved in one pass when the outermost fire returns, so
+ * firing never copies the handler list. Handlers added during a fire are
+ * first called by the next one.
+ *
+ * A handler may be bound to the lifetime of an Object. Once the object is
+ * destroyed the handler is neither called nor reported as connected, and the
+ * next fire drops it. fire() only looks at the lifetimes after some tracked
+ * object has been destroyed, so bound handlers cost nothing until then.
+ ******************************************************************************/
+class EventBase : public Object {
+ public:
+  EventBase() = default;
+  EventBase(const EventBase&) = delete;
+  EventBase& operator=(const EventBase&) = delete;
+  ~EventBase() override;
+
+  void removeHandler(EventConnection& connection) { connection.disconnect(); }
+  std::size_t size() const { return owners_.size() - tombstones_; }
+  bool empty() const { return size() == 0; }
+
+ protected:
+  // Marks a fire() in progress for as long as it lives.
+  class DispatchScope {
+   public:
+    explicit DispatchScope(EventBase* event) : event_(event) {
+      ++event_->depth_;
+    }
+    DispatchScope(const DispatchScope&) = delete;
+    DispatchScope& operator=(const DispatchScope&) = delete;
+    ~DispatchScope() {
+      if (!--event_->depth_ && event_->dirty_) event_->compact();
+    }
+
+   private:
+    EventBase* event_;
+  };
+
+  bool dispatching() const { return depth_ != 0; }
+  // Whether the handler at |index| is still connected, dropping those whose
+  // owner has been destroyed. Only called while dispatching.
+  bool live(std::size_t index) {
+    if (tracked_ && expirations_ != ObjectLifetime::expirations()) sweep();
+    return owners_[index] != kNone;
+  }
+  // Takes a slot for a handler that the derived class has just added, at the
+  // end of its handlers or, while dispatching, of the ones set aside. The
+  // handler is bound to |lifetime| if it is not null.
+  EventConnection connect(ObjectLifetime* lifetime);
+  // Appends the handlers set aside during dispatch.
+  virtual void commit() = 0;
+  virtual void moveHandler(std::size_t from, std::size_t to) = 0;
+  // Drops the handlers from |size| on.
+  virtual void truncate(std::size_t size) = 0;
+
+ private:
+  struct Slot {
+    // The position of the handler, or the next free slot.
+    std::uint32_t index;
+    std::uint32_t generation;
+  };
+  static constexpr std::uint32_t kNone = ~std::uint32_t(0);
+
+  bool connected(std::uint32_t slot, std::uint32_t generation) const;
+  void disconnect(std::uint32_t slot, std::uint32_t generation);
+  // Drops the tombstones and commits the handlers added during dispatch.
+  void compact();
+  // Disconnects the handlers whose owner has been destroyed.
+  void sweep();
+
+  std::vector<Slot> slots_;
+  // The slot of the handler at each position, or kNone for a tombstone.
+  std::vector<std::uint32_t> owners_;
+  // The lifetime each position is bound to, or null.
+  std::vector<ObjectLifetime*> lifetimes_;
+  std::uint32_t free_ = kNone;
+  std::uint32_t depth_ = 0;
+  std::uint32_t tombstones_ = 0;
+  // The number of bound handlers, and ObjectLifetime::expirations() when
+  // they were last checked.
+  std::uint32_t tracked_ = 0;
+  std::uint32_t expirations_ = 0;
+  // Whether there is work for compact().
+  bool dirty_ = false;
+  // Shared with the connections, and cleared when the event goes away.
+  std::shared_ptr<EventBase*> self_;
+  friend class EventConnection;
+};
+
 template <typename HandlerType>
 class Event;
 
+/*******************************************************************************
+ * class Event
+ *
+ * Handlers are InlineFunctions, so a lambda capturing up to three pointers or
+ * a member function bound to an object is stored without an allocation and
+ * called through a single indirect call.
+ ******************************************************************************/
 template <typename R, typename... Args>
-class Event<R(Args...)> : public Object {
+class Event<R(Args...)> : public EventBase {
  public:
   typedef R(HandlerType)(Args...);
+  using Handler = InlineFunction<HandlerType>;
 
   Event() = default;
 
   template <typename F>
-  void addHandler(F&& f) {
-    handlers_.emplace_back(std::forward<F>(f));
+  EventConnection addHandler(F&& f) {
+    return add(nullptr, std::forward<F>(f));
   }
-
-  void removeHandler(const std::function<HandlerType>& handler) {
-    handlers_.erase(std::remove(handlers_.begin(), handlers_.end(), handler),
-                    handlers_.end());
+  // Calls |f| as long as |owner| is alive.
+  template <typename F,
+            typename = std::enable_if_t<
+                !std::is_member_function_pointer<std::decay_t<F>>::value>>
+  EventConnection addHandler(const Object* owner, F&& f) {
+    return add(owner->lifetime(), std::forward<F>(f));
+  }
+  // Calls |method| on |object|. If T is an Object the handler is bound to
+  // its lifetime; otherwise |object| must stay alive while connected.
+  template <typename T, typename Method,
+            typename = std::enable_if_t<
+                std::is_member_function_pointer<Method>::value>>
+  EventConnection addHandler(T* object, Method method) {
+    if constexpr (std::is_base_of<Object, T>::value) {
+      return add(object->lifetime(), Handler(object, method));
+    } else {
+      return add(nullptr, Handler(object, method));
+    }
   }
 
   void fire(Args... args) {
-    for (const auto& h : handlers_) {
-      h(args...);
+    DispatchScope scope(this);
+    for (std::size_t i = 0, size = handlers_.size(); i < size; ++i) {
+      if (live(i)) handlers_[i](args...);
     }
   }
 
+ protected:
+  void commit() override {
+    for (auto& handler : added_) {
+      handlers_.push_back(std::move(handler));
+    }
+    added_.clear();
+  }
+  void moveHandler(std::size_t from, std::size_t to) override {
+    handlers_[to] = std::move(handlers_[from]);
+  }
+  void truncate(std::size_t size) override {
+    handlers_.erase(handlers_.begin() + size, handlers_.end());
+  }
+
  private:
-  std::vector<std::function<HandlerType>> handlers_;
+  template <typename F>
+  EventConnection add(ObjectLifetime* lifetime, F&& f) {
+    if (dispatching()) {
+      added_.emplace_back(std::forward<F>(f));
+    } else {
+      handlers_.emplace_back(std::forward<F>(f));
+    }
+    return connect(lifetime);
+  }
+
+  std::vector<Handler> handlers_;
+  // Added while dispatching, in position order after handlers_.
+  std::vector<Handler> added_;
 };
 
 class EventArgs : public Object {
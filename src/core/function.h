@@ -0,0 +1,204 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace yuki {
+
+/*******************************************************************************
+ * class InlineFunction
+ *
+ * A copyable type-erased callable like std::function, except that any
+ * callable of up to |Capacity| bytes is stored in place. Larger ones fall
+ * back to the heap. Trivially copyable callables, such as lambdas capturing
+ * only pointers and references, are copied and moved as raw bytes.
+ *
+ * It can also call a member function on an object it does not own:
+ *
+ *   InlineFunction<void(int)> f(&window, &Window::resize);
+ ******************************************************************************/
+template <typename Signature, std::size_t Capacity = 3 * sizeof(void*)>
+class InlineFunction;
+
+template <typename R, typename... Args, std::size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+  static_assert(Capacity >= sizeof(void*), "Capacity too small");
+
+ public:
+  InlineFunction() = default;
+  InlineFunction(std::nullptr_t) {}
+  template <typename F,
+            typename = std::enable_if_t<
+                !std::is_same<std::decay_t<F>, InlineFunction>::value &&
+                std::is_invocable_r<R, std::decay_t<F>&, Args...>::value>>
+  InlineFunction(F&& f) {
+    assign(std::forward<F>(f));
+  }
+  // Calls |method| on |object|, which must outlive the function.
+  template <typename T, typename Method,
+            typename = std::enable_if_t<
+                std::is_member_function_pointer<Method>::value>>
+  InlineFunction(T* object, Method method) {
+    assign(Bound<T, Method>{object, method});
+  }
+  InlineFunction(const InlineFunction& other)
+      : invoke_(other.invoke_), manage_(other.manage_) {
+    transfer(Operation::kCopy, &other.storage_);
+  }
+  InlineFunction(InlineFunction&& other) noexcept
+      : invoke_(other.invoke_), manage_(other.manage_) {
+    transfer(Operation::kMove, &other.storage_);
+    other.invoke_ = nullptr;
+    other.manage_ = nullptr;
+  }
+  InlineFunction& operator=(const InlineFunction& other) {
+    if (this != &other) {
+      InlineFunction copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+  InlineFunction& operator=(InlineFunction&& other) noexcept {
+    if (this != &other) {
+      reset();
+      invoke_ = other.invoke_;
+      manage_ = other.manage_;
+      transfer(Operation::kMove, &other.storage_);
+      other.invoke_ = nullptr;
+      other.manage_ = nullptr;
+    }
+    return *this;
+  }
+  InlineFunction& operator=(std::nullptr_t) {
+    reset();
+    return *this;
+  }
+  ~InlineFunction() { reset(); }
+
+  explicit operator bool() const { return invoke_ != nullptr; }
+
+  R operator()(Args... args) const {
+    return invoke_(&storage_, std::forward<Args>(args)...);
+  }
+
+  // Whether a callable of type F is stored without a heap allocation.
+  template <typename F>
+  static constexpr bool isInline() {
+    return sizeof(F) <= Capacity && alignof(F) <= alignof(Storage) &&
+           std::is_nothrow_move_constructible<F>::value;
+  }
+  // Whether a callable of type F is stored in place and needs no manager.
+  template <typename F>
+  static constexpr bool isTrivial() {
+    return isInline<F>() && std::is_trivially_copyable<F>::value &&
+           std::is_trivially_destructible<F>::value;
+  }
+
+ private:
+  enum class Operation { kCopy, kMove, kDestroy };
+  using Storage = std::aligned_storage_t<Capacity, alignof(void*)>;
+  using Invoker = R (*)(void* storage, Args&&... args);
+  using Manager = void (*)(Operation operation, void* target, void* source);
+
+  template <typename F>
+  static R call(F& f, Args&&... args) {
+    if constexpr (std::is_void<R>::value) {
+      f(std::forward<Args>(args)...);
+    } else {
+      return f(std::forward<Args>(args)...);
+    }
+  }
+
+  template <typename T, typename Method>
+  struct Bound {
+    decltype(auto) operator()(Args&&... args) const {
+      return (object->*method)(std::forward<Args>(args)...);
+    }
+
+    T* object;
+    Method method;
+  };
+
+  template <typename F>
+  struct Local {
+    static F* get(void* storage) {
+      return std::launder(static_cast<F*>(storage));
+    }
+    static R invoke(void* storage, Args&&... args) {
+      return call(*get(storage), std::forward<Args>(args)...);
+    }
+    static void manage(Operation operation, void* target, void* source) {
+      switch (operation) {
+        case Operation::kCopy:
+          new (target) F(*get(source));
+          break;
+        case Operation::kMove:
+          new (target) F(std::move(*get(source)));
+          get(source)->~F();
+          break;
+        case Operation::kDestroy:
+          get(target)->~F();
+          break;
+      }
+    }
+  };
+
+  template <typename F>
+  struct Remote {
+    static F*& get(void* storage) { return *static_cast<F**>(storage); }
+    static R invoke(void* storage, Args&&... args) {
+      return call(*get(storage), std::forward<Args>(args)...);
+    }
+    static void manage(Operation operation, void* target, void* source) {
+      switch (operation) {
+        case Operation::kCopy:
+          new (target) F*(new F(*get(source)));
+          break;
+        case Operation::kMove:
+          new (target) F*(get(source));
+          break;
+        case Operation::kDestroy:
+          delete get(target);
+          break;
+      }
+    }
+  };
+
+  template <typename F>
+  void assign(F&& f) {
+    using Functor = std::decay_t<F>;
+    using Handler = std::conditional_t<isInline<Functor>(), Local<Functor>,
+                                       Remote<Functor>>;
+    if constexpr (isInline<Functor>()) {
+      new (&storage_) Functor(std::forward<F>(f));
+    } else {
+      new (&storage_) Functor*(new Functor(std::forward<F>(f)));
+    }
+    invoke_ = &Handler::invoke;
+    manage_ = isTrivial<Functor>() ? nullptr : &Handler::manage;
+  }
+
+  // Copies or moves the callable of |source| into the empty storage_, once
+  // invoke_ and manage_ are set.
+  void transfer(Operation operation, const Storage* source) {
+    if (manage_) {
+      manage_(operation, &storage_, const_cast<Storage*>(source));
+    } else if (invoke_) {
+      std::memcpy(&storage_, source, sizeof(Storage));
+    }
+  }
+
+  void reset() {
+    if (manage_) manage_(Operation::kDestroy, &storage_, nullptr);
+    invoke_ = nullptr;
+    manage_ = nullptr;
+  }
+
+  mutable Storage storage_;
+  Invoker invoke_ = nullptr;
+  Manager manage_ = nullptr;
+};
+
+}  // namespace yuki
@@ -1,64 +1,591 @@
 #include "logger.h"
 #include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <mutex>
+#include <thread>
 #include <vector>
+#include "core/binary_logger.h"
 
 namespace yuki {
+/*******************************************************************************
+ * class LoggerRing
+ *
+ * A lock-free single-producer single-consumer ring of records: the records
+ * logged by one thread, on their way to the writer thread. A record is a
+ * header and its bytes: the characters of a text line, followed by a null
+ * character, or a binary record. Records never wrap around, so that the
+ * writer can hand them to listeners in place; one that does not fit before
+ * the end of the buffer is preceded by padding. Positions only grow, and are
+ * reduced modulo the size when used.
+ ******************************************************************************/
+class LoggerRing {
+ public:
+  enum class Kind : std::uint32_t { Text, Binary, Padding };
+
+  static constexpr std::size_t kSize = 1 << 16;
+  static_assert(Logger::kMaxLength * sizeof(Char) < kSize / 4 &&
+                    BinaryLogger::kMaxSize < kSize / 4,
+                "Records too long for the ring");
+
+  LoggerRing() : buffer_(new unsigned char[kSize]) {}
+  LoggerRing(const LoggerRing&) = delete;
+  LoggerRing& operator=(const LoggerRing&) = delete;
+
+  // Producer side. Returns false if there is no room.
+  bool push(Kind kind, const void* data, std::size_t size);
+  // Consumer side. Calls |f| with the kind, the bytes and the size of each
+  // record, and returns how many there were.
+  template <typename F>
+  std::size_t drain(F&& f);
+  bool empty() const {
+    return tail_.load(std::memory_order_relaxed) ==
+           head_.load(std::memory_order_acquire);
+  }
+  // Producer side: whether the writer should come early.
+  bool halfFull() {
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head - cachedTail_ <= kSize / 2) return false;
+    cachedTail_ = tail_.load(std::memory_order_acquire);
+    return head - cachedTail_ > kSize / 2;
+  }
+
+  // Set by the producer when its thread exits.
+  std::atomic<bool> closed{false};
+  // Records discarded under LoggerOverflow::Count and not reported yet.
+  // Producer side.
+  std::uint64_t dropped = 0;
+
+ private:
+  struct Header {
+    // The length of the record in bytes, or of the padding.
+    std::uint32_t size;
+    Kind kind;
+  };
+  static constexpr std::size_t kMask = kSize - 1;
+
+  static std::size_t align(std::size_t size) {
+    return (size + sizeof(Header) - 1) & ~(sizeof(Header) - 1);
+  }
+
+  std::unique_ptr<unsigned char[]> buffer_;
+  alignas(64) std::atomic<std::size_t> head_{0};
+  // The producer's last view of tail_, so that it only reads the consumer's
+  // cache line when the ring looks full.
+  std::size_t cachedTail_ = 0;
+  alignas(64) std::atomic<std::size_t> tail_{0};
+};
+
+bool LoggerRing::push(Kind kind, const void* data, std::size_t bytes) {
+  auto size = align(sizeof(Header) + bytes);
+  auto head = head_.load(std::memory_order_relaxed);
+  auto offset = head & kMask;
+  auto padding = kSize - offset < size ? kSize - offset : 0;
+  if (head + padding + size - cachedTail_ > kSize) {
+    cachedTail_ = tail_.load(std::memory_order_acquire);
+    if (head + padding + size - cachedTail_ > kSize) return false;
+  }
+  if (padding) {
+    Header header{static_cast<std::uint32_t>(padding), Kind::Padding};
+    std::memcpy(&buffer_[offset], &header, sizeof(header));
+    head += padding;
+    offset = 0;
+  }
+  Header header{static_cast<std::uint32_t>(bytes), kind};
+  std::memcpy(&buffer_[offset], &header, sizeof(header));
+  std::memcpy(&buffer_[offset + sizeof(header)], data, bytes);
+  head_.store(head + size, std::memory_order_release);
+  return true;
+}
+
+template <typename F>
+std::size_t LoggerRing::drain(F&& f) {
+  auto tail = tail_.load(std::memory_order_relaxed);
+  auto head = head_.load(std::memory_order_acquire);
+  std::size_t count = 0;
+  while (tail != head) {
+    auto offset = tail & kMask;
+    Header header;
+    std::memcpy(&header, &buffer_[offset], sizeof(header));
+    if (header.kind == Kind::Padding) {
+      tail += header.size;
+      continue;
+    }
+    f(header.kind, &buffer_[offset + sizeof(header)], header.size);
+    tail += align(sizeof(header) + header.size);
+    // Released record by record, so that a blocked producer resumes early.
+    tail_.store(tail, std::memory_order_release);
+    ++count;
+  }
+  return count;
+}
+
+/*******************************************************************************
+ * class LoggerListeners
+ *
+ * The listeners, as an immutable list behind an atomic pointer. A change
+ * copies the list and swaps the copy in, so the writer reads the list
+ * without a lock, and a change never waits for a listener that is being
+ * called. The reader pins the list it uses with a hazard pointer; a list
+ * replaced while pinned is freed when the reader lets go of it. Readers hold
+ * LoggerPrivate::mutex, so there is only ever one, and one hazard pointer is
+ * enough.
+ ******************************************************************************/
+class LoggerListeners {
+ public:
+  using List = std::vector<std::shared_ptr<ILoggerListener>>;
+
+  // Pins the current list while it lives.
+  class Snapshot {
+   public:
+    explicit Snapshot(LoggerListeners& listeners);
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+    ~Snapshot();
+
+    List::const_iterator begin() const { return list_->begin(); }
+    List::const_iterator end() const { return list_->end(); }
+
+   private:
+    LoggerListeners& listeners_;
+    const List* list_;
+  };
+
+  LoggerListeners() = default;
+  LoggerListeners(const LoggerListeners&) = delete;
+  LoggerListeners& operator=(const LoggerListeners&) = delete;
+  ~LoggerListeners();
+
+  void add(std::shared_ptr<ILoggerListener> listener);
+  void remove(const std::shared_ptr<ILoggerListener>& listener);
+
+ private:
+  // Swaps in |list| and retires the old one. Called with mutex_ held.
+  void replace(std::unique_ptr<const List> list);
+  // Takes the retired lists that are not pinned. Called with mutex_ held.
+  std::vector<std::unique_ptr<const List>> reclaim();
+
+  std::atomic<const List*> current_{nullptr};
+  std::atomic<const List*> pinned_{nullptr};
+  // Serializes changes; the reader only takes it to free retired lists.
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<const List>> retired_;
+  std::atomic<bool> retiring_{false};
+};
+
+LoggerListeners::Snapshot::Snapshot(LoggerListeners& listeners)
+    : listeners_(listeners) {
+  static const List empty;
+  auto list = listeners.current_.load();
+  for (;;) {
+    // A change that swapped the list out before it was pinned may not have
+    // seen the pin, so it is only safe if it is still current.
+    listeners.pinned_.store(list);
+    auto current = listeners.current_.load();
+    if (current == list) break;
+    list = current;
+  }
+  list_ = list ? list : &empty;
+}
+
+LoggerListeners::Snapshot::~Snapshot() {
+  listeners_.pinned_.store(nullptr);
+  if (!listeners_.retiring_.load()) return;
+  std::vector<std::unique_ptr<const List>> lists;
+  std::lock_guard<std::mutex> lock(listeners_.mutex_);
+  lists = listeners_.reclaim();
+}
+
+LoggerListeners::~LoggerListeners() {
+  delete current_.load();
+}
+
+void LoggerListeners::add(std::shared_ptr<ILoggerListener> listener) {
+  // Destroyed after the lock is released, as listeners may take a while.
+  std::vector<std::unique_ptr<const List>> lists;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto current = current_.load();
+  auto list =
+      current ? std::make_unique<List>(*current) : std::make_unique<List>();
+  list->push_back(std::move(listener));
+  replace(std::move(list));
+  lists = reclaim();
+}
+
+void LoggerListeners::remove(const std::shared_ptr<ILoggerListener>& listener) {
+  std::vector<std::unique_ptr<const List>> lists;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto current = current_.load();
+  if (!current ||
+      std::find(current->begin(), current->end(), listener) ==
+          current->end()) {
+    return;
+  }
+  auto list = std::make_unique<List>(*current);
+  list->erase(std::remove(list->begin(), list->end(), listener), list->end());
+  replace(std::move(list));
+  lists = reclaim();
+}
+
+void LoggerListeners::replace(std::unique_ptr<const List> list) {
+  if (auto old = current_.exchange(list.release())) retired_.emplace_back(old);
+}
+
+std::vector<std::unique_ptr<const LoggerListeners::List>>
+LoggerListeners::reclaim() {
+  std::vector<std::unique_ptr<const List>> lists;
+  if (retired_.empty()) return lists;
+  // Set before the pin is read, as the reader clears the pin before it reads
+  // this: either the pin is seen cleared here, or the reader comes back for
+  // the list it had pinned.
+  retiring_.store(true);
+  auto pinned = pinned_.load();
+  for (auto& list : retired_) {
+    if (list.get() != pinned) lists.push_back(std::move(list));
+  }
+  retired_.erase(std::remove(retired_.begin(), retired_.end(), nullptr),
+                 retired_.end());
+  if (retired_.empty()) retiring_.store(false);
+  return lists;
+}
+
 /*******************************************************************************
  * class Logger
  ******************************************************************************/
 class LoggerPrivate {
  public:
+  // Guards everything but the atomics and the listeners, and is held by the
+  // writer while it writes.
   static std::mutex mutex;
-  static std::vector<std::shared_ptr<ILoggerListener>> listeners;
+  static LoggerListeners listeners;
+  static std::vector<std::unique_ptr<LoggerRing>> rings;
+  static std::atomic<LoggerOverflow> overflow;
+  static std::atomic<std::uint64_t> dropped;
+
+  // Waking the writer costs more than a record, so it drains the rings on a
+  // timer, and is only woken up early by a ring filling up or by flush().
+  static constexpr std::chrono::milliseconds kInterval{50};
+  static std::thread writer;
+  // Set when the writer is woken up early; only the first signal notifies.
+  static std::atomic<bool> signaled;
+  static std::condition_variable wake;
+  static std::condition_variable flushed;
+  static std::uint64_t flushRequests;
+  static std::uint64_t flushes;
+  static std::atomic<bool> stopping;
+
+  static void submit(LoggerRing::Kind kind, const void* data,
+                     std::size_t size);
+  static void signal() {
+    if (!signaled.load(std::memory_order_relaxed) && !signaled.exchange(true)) {
+      wake.notify_one();
+    }
+  }
+  static void deliver(const LoggerListeners::Snapshot& listeners,
+                      LoggerRing::Kind kind, const unsigned char* data,
+                      std::size_t size);
+  static void run();
+  // Drains every ring once; returns whether any record was written.
+  static bool drain();
+  static void stop();
 };
 
 std::mutex LoggerPrivate::mutex;
-std::vector<std::shared_ptr<ILoggerListener>> LoggerPrivate::listeners;
+LoggerListeners LoggerPrivate::listeners;
+std::vector<std::unique_ptr<LoggerRing>> LoggerPrivate::rings;
+std::atomic<LoggerOverflow> LoggerPrivate::overflow{LoggerOverflow::Drop};
+std::atomic<std::uint64_t> LoggerPrivate::dropped{0};
+std::thread LoggerPrivate::writer;
+std::atomic<bool> LoggerPrivate::signaled{false};
+std::condition_variable LoggerPrivate::wake;
+std::condition_variable LoggerPrivate::flushed;
+std::uint64_t LoggerPrivate::flushRequests = 0;
+std::uint64_t LoggerPrivate::flushes = 0;
+std::atomic<bool> LoggerPrivate::stopping{false};
 
-Logger::Logger(const String& tag) {
-  LoggerPrivate::mutex.lock();
-  for (auto& listener : LoggerPrivate::listeners) {
-    listener->write(tag);
-    listener->write(TEXT(" "));
+namespace {
+// The ring of the current thread, closed when the thread exits.
+struct LoggerThread {
+  ~LoggerThread() {
+    if (ring) ring->closed.store(true, std::memory_order_release);
   }
+
+  LoggerRing* ring = nullptr;
+  bool writer = false;
+};
+thread_local LoggerThread loggerThread;
+
+// Destroyed before the other statics of the logger, which it still uses.
+struct LoggerShutdown {
+  ~LoggerShutdown() { LoggerPrivate::stop(); }
+} loggerShutdown;
+
+// Formats |value| with std::to_chars and widens it into |out|, which must
+// have room for 64 characters.
+template <typename T>
+std::size_t formatNumber(Char* out, T value) {
+  char text[64];
+  auto end = std::to_chars(text, text + sizeof(text), value).ptr;
+  std::copy(text, end, out);
+  return end - text;
 }
+}  // namespace
 
-Logger::~Logger() {
-  for (auto& listener : LoggerPrivate::listeners) {
-    listener->write(TEXT("\n"));
-    listener->flush();
+void LoggerPrivate::submit(LoggerRing::Kind kind, const void* data,
+                           std::size_t size) {
+  auto& thread = loggerThread;
+  if (thread.writer) return;
+  if (!thread.ring) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping) {
+      // Logging during shutdown; write synchronously.
+      LoggerListeners::Snapshot snapshot(listeners);
+      deliver(snapshot, kind, static_cast<const unsigned char*>(data), size);
+      return;
+    }
+    rings.push_back(std::make_unique<LoggerRing>());
+    thread.ring = rings.back().get();
+    if (!writer.joinable()) writer = std::thread(&LoggerPrivate::run);
   }
-  LoggerPrivate::mutex.unlock();
+  auto ring = thread.ring;
+  for (;;) {
+    if (ring->dropped) {
+      // Reported in the place of the lost records, once there is room.
+      const StringView prefix = TEXT("|Warning| ");
+      const StringView suffix = TEXT(" log records dropped\n");
+      Char notice[64];
+      auto length = prefix.copy(notice, prefix.size());
+      length += formatNumber(notice + length, ring->dropped);
+      length += suffix.copy(notice + length, suffix.size());
+      notice[length++] = Char();
+      if (ring->push(LoggerRing::Kind::Text, notice, length * sizeof(Char))) {
+        ring->dropped = 0;
+      }
+    }
+    if (!ring->dropped && ring->push(kind, data, size)) break;
+    switch (overflow.load(std::memory_order_relaxed)) {
+      case LoggerOverflow::Drop:
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      case LoggerOverflow::Count:
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        ++ring->dropped;
+        return;
+      case LoggerOverflow::Block:
+        if (stopping.load()) return;
+        signal();
+        std::this_thread::yield();
+        break;
+    }
+  }
+  if (ring->halfFull()) signal();
 }
 
-void Logger::write(const String& message) {
-  for (auto& listener : LoggerPrivate::listeners) {
-    listener->write(message);
+void LoggerPrivate::deliver(const LoggerListeners::Snapshot& listeners,
+                            LoggerRing::Kind kind, const unsigned char* data,
+                            std::size_t size) {
+  if (kind == LoggerRing::Kind::Text) {
+    // Without the null character.
+    StringView record(reinterpret_cast<const Char*>(data),
+                      size / sizeof(Char) - 1);
+    for (auto& listener : listeners) {
+      listener->write(record);
+    }
+    return;
+  }
+  LogRecord record;
+  std::memcpy(&record.site, data, sizeof(record.site));
+  std::memcpy(&record.time, data + sizeof(record.site), sizeof(record.time));
+  auto header = sizeof(record.site) + sizeof(record.time);
+  record.arguments = data + header;
+  record.size = size - header;
+  for (auto& listener : listeners) {
+    listener->write(record);
   }
 }
 
+bool LoggerPrivate::drain() {
+  bool written = false;
+  for (auto it = rings.begin(); it != rings.end();) {
+    auto& ring = **it;
+    // Read before draining: a closed ring gets no more records.
+    bool closed = ring.closed.load(std::memory_order_acquire);
+    if (!ring.empty()) {
+      // Pinned ring by ring, so that a replaced list is freed soon.
+      LoggerListeners::Snapshot snapshot(listeners);
+      ring.drain([&snapshot](LoggerRing::Kind kind, const unsigned char* data,
+                             std::size_t size) {
+        deliver(snapshot, kind, data, size);
+      });
+      written = true;
+    }
+    if (closed && ring.empty()) {
+      it = rings.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return written;
+}
+
+void LoggerPrivate::run() {
+  loggerThread.writer = true;
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    signaled.store(false);
+    auto request = flushRequests;
+    bool written = drain();
+    if (written || request != flushes) {
+      LoggerListeners::Snapshot snapshot(listeners);
+      for (auto& listener : snapshot) {
+        listener->flush();
+      }
+    }
+    if (request != flushes) {
+      flushes = request;
+      flushed.notify_all();
+    }
+    if (written) {
+      // Let other threads register rings and flush.
+      lock.unlock();
+      lock.lock();
+      continue;
+    }
+    if (stopping) break;
+    // A notification that slips in between the check of |signaled| and the
+    // wait is only late by one interval.
+    if (!signaled.load()) wake.wait_for(lock, kInterval);
+  }
+}
+
+void LoggerPrivate::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping.store(true);
+  }
+  wake.notify_one();
+  if (writer.joinable()) writer.join();
+}
+
+std::atomic<int> Logger::level_{static_cast<int>(LogLevel::Trace)};
+
+Logger::Logger(const String& tag) {
+  begin(tag);
+  append(TEXT(" "), 1);
+}
+
+Logger::Logger(LogLevel level) {
+  if (isEnabled(level)) begin(tag(level));
+}
+
+Logger::Logger(LogLevel level, std::uint64_t suppressed) : Logger(level) {
+  if (!buffer_ || !suppressed) return;
+  write(TEXT("("));
+  write(static_cast<unsigned long long>(suppressed));
+  write(TEXT(" suppressed) "));
+}
+
+Logger::~Logger() {
+  if (!buffer_) return;
+  auto& size = buffer_->size;
+  buffer_->data[size++] = TEXT('\n');
+  buffer_->data[size] = Char();
+  LoggerPrivate::submit(LoggerRing::Kind::Text, buffer_->data + start_,
+                        (size + 1 - start_) * sizeof(Char));
+  size = start_;
+}
+
+StringView Logger::tag(LogLevel level) {
+  static const StringView tags[] = {
+      TEXT("|Trace| "),   TEXT("|DEBUG| "), TEXT("|Info| "),
+      TEXT("|Warning| "), TEXT("|Error| "), TEXT("|Fatal| "),
+  };
+  return tags[static_cast<int>(level)];
+}
+
+void Logger::write(long long value) {
+  if (!buffer_) return;
+  Char text[64];
+  append(text, formatNumber(text, value));
+}
+
+void Logger::write(unsigned long long value) {
+  if (!buffer_) return;
+  Char text[64];
+  append(text, formatNumber(text, value));
+}
+
+void Logger::write(float value) {
+  if (!buffer_) return;
+  Char text[64];
+  append(text, formatNumber(text, value));
+}
+
+void Logger::write(double value) {
+  if (!buffer_) return;
+  Char text[64];
+  append(text, formatNumber(text, value));
+}
+
+void Logger::write(long double value) {
+  if (!buffer_) return;
+  Char text[64];
+  append(text, formatNumber(text, value));
+}
+
+Logger::Buffer& Logger::buffer() {
+  thread_local std::unique_ptr<Buffer> buffer(new Buffer);
+  return *buffer;
+}
+
+void Logger::begin(StringView tag) {
+  buffer_ = &buffer();
+  start_ = buffer_->size;
+  append(tag.data(), tag.size());
+}
+
 void Logger::addListener(std::shared_ptr<ILoggerListener> listener) {
-  LoggerPrivate::listeners.push_back(std::move(listener));
+  LoggerPrivate::listeners.add(std::move(listener));
 }
 
 void Logger::removeListener(const std::shared_ptr<ILoggerListener>& listener) {
-  LoggerPrivate::listeners.erase(
-      std::remove(LoggerPrivate::listeners.begin(),
-                  LoggerPrivate::listeners.end(), listener),
-      LoggerPrivate::listeners.end());
+  LoggerPrivate::listeners.remove(listener);
+}
+
+void Logger::flush() {
+  std::unique_lock<std::mutex> lock(LoggerPrivate::mutex);
+  if (!LoggerPrivate::writer.joinable() || LoggerPrivate::stopping) return;
+  auto request = ++LoggerPrivate::flushRequests;
+  LoggerPrivate::wake.notify_one();
+  LoggerPrivate::flushed.wait(
+      lock, [request] { return LoggerPrivate::flushes >= request; });
+}
+
+void Logger::setOverflow(LoggerOverflow overflow) {
+  LoggerPrivate::overflow.store(overflow, std::memory_order_relaxed);
+}
+
+std::uint64_t Logger::dropped() {
+  return LoggerPrivate::dropped.load(std::memory_order_relaxed);
+}
+
+void BinaryLogger::submit(const unsigned char* record, std::size_t size) {
+  LoggerPrivate::submit(LoggerRing::Kind::Binary, record, size);
 }
 
-Logger Logger::debug() { return Logger{TEXT("|DEBUG|")}; }
+Logger Logger::debug() { return Logger{LogLevel::Debug}; }
 
-Logger Logger::error() { return Logger{TEXT("|Error|")}; }
+Logger Logger::error() { return Logger{LogLevel::Error}; }
 
-Logger Logger::fatal() { return Logger{TEXT("|Fatal|")}; }
+Logger Logger::fatal() { return Logger{LogLevel::Fatal}; }
 
-Logger Logger::trace() { return Logger{TEXT("|Trace|")}; }
+Logger Logger::trace() { return Logger{LogLevel::Trace}; }
 
-Logger Logger::info() { return Logger{TEXT("|Info|")}; }
+Logger Logger::info() { return Logger{LogLevel::Info}; }
 
-Logger Logger::warning() { return Logger{TEXT("|Warning|")}; }
+Logger Logger::warning() { return Logger{LogLevel::Warning}; }
 
 }  // namespace yuki
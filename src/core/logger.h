@@ -1,8 +1,86 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include "core/string.hpp"
 
+// The least severe level compiled in, as the value of its LogLevel: 0 for
+// Trace up to 5 for Fatal. YUKI_LOG statements below it compile to nothing.
+#ifndef YUKI_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define YUKI_LOG_MIN_LEVEL 2
+#else
+#define YUKI_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+// Logs a record at a LogLevel, if the level is compiled in and enabled:
+//
+//   YUKI_LOG(Trace) << TEXT("mouseMoveEvent: ") << position.x();
+//
+// The operands are only evaluated if the record is written.
+#define YUKI_LOG(level)                                                \
+  if constexpr (static_cast<int>(::yuki::LogLevel::level) <            \
+                YUKI_LOG_MIN_LEVEL) {                                  \
+  } else if (!::yuki::Logger::isEnabled(::yuki::LogLevel::level)) {    \
+  } else                                                               \
+    ::yuki::Logger(::yuki::LogLevel::level)
+
+// Like YUKI_LOG, but writes one in |n| records of the statement:
+//
+//   YUKI_LOG_EVERY_N(Trace, 100) << TEXT("mouseMoveEvent: ") << position.x();
+//
+// |n| must be a constant.
+#define YUKI_LOG_EVERY_N(level, n) \
+  YUKI_LOG_LIMITED(level, ::yuki::LogSampler, n)
+
+// Like YUKI_LOG, but writes at most |burst| records of the statement at once,
+// and |perSecond| on average:
+//
+//   YUKI_LOG_RATE_LIMITED(Error, 1, 10) << TEXT("render failed: ") << error;
+//
+// Both must be constants. A record written after some were dropped starts
+// with their count, such as "(1234 suppressed)".
+#define YUKI_LOG_RATE_LIMITED(level, perSecond, burst) \
+  YUKI_LOG_LIMITED(level, ::yuki::LogRateLimiter, perSecond, burst)
+
+// The limiter lives in a static of the call site; with constant arguments it
+// is initialized at compile time, so checking it costs no guard.
+#define YUKI_LOG_LIMITED(level, Limiter, ...)                          \
+  if constexpr (static_cast<int>(::yuki::LogLevel::level) <            \
+                YUKI_LOG_MIN_LEVEL) {                                  \
+  } else if (!::yuki::Logger::isEnabled(::yuki::LogLevel::level)) {    \
+  } else if (auto yukiSuppressed =                                     \
+                 []() -> Limiter& {                                    \
+                   static Limiter limiter(__VA_ARGS__);                \
+                   return limiter;                                     \
+                 }().admit();                                          \
+             yukiSuppressed < 0) {                                     \
+  } else                                                               \
+    ::yuki::Logger(::yuki::LogLevel::level,                            \
+                   static_cast<std::uint64_t>(yukiSuppressed))
+
 namespace yuki {
+struct LogRecord;
+
+enum class LogLevel { Trace, Debug, Info, Warning, Error, Fatal };
+
+// What a thread does with a record when its buffer is full.
+enum class LoggerOverflow {
+  // Discard the record.
+  Drop,
+  // Wait for the writer to make room.
+  Block,
+  // Discard the record, and log how many were discarded once there is room.
+  Count,
+};
+
+// Listeners are called on the writer thread, one record at a time, and
+// must not log. A text record is a whole line, ending with a newline; it is
+// only valid during the call, and is followed by a null character so that it
+// can be passed on to C APIs.
 class ILoggerListener {
  public:
   ILoggerListener() = default;
@@ -11,21 +89,79 @@ class ILoggerListener {
   ILoggerListener& operator=(const ILoggerListener&) = default;
   ILoggerListener& operator=(ILoggerListener&&) = default;
   virtual ~ILoggerListener() = default;
-  virtual void write(const String& message) = 0;
+  virtual void write(StringView message) = 0;
+  // A binary record, see YUKI_LOG_BINARY. By default it is formatted and
+  // written as text.
+  virtual void write(const LogRecord& record);
   virtual void flush() {}
 };
 
+/*******************************************************************************
+ * class Logger
+ *
+ * A Logger collects one record, a line, and hands it over when it goes out
+ * of scope. Records are written asynchronously: each thread copies them into
+ * its own lock-free ring buffer, and a background thread drains the buffers
+ * into the listeners. Records of one thread keep their order; records of
+ * different threads are interleaved as the writer finds them.
+ *
+ * The record is formatted in place into a buffer owned by the thread, and
+ * reused by every record, so logging does not allocate. Records nest: a
+ * Logger created while another one is being written, say by a function
+ * called for an operand, takes the rest of the buffer and gives it back.
+ * Records longer than kMaxLength are truncated.
+ *
+ * Records below the runtime level are not written. The factories check it
+ * only after their operands have been evaluated; YUKI_LOG checks it first.
+ ******************************************************************************/
 class Logger {
  public:
+  // In characters, including the newline.
+  static constexpr std::size_t kMaxLength = 2048;
+
   explicit Logger(const String& tag);
+  // A record at |level|, ignored if the level is not enabled.
+  explicit Logger(LogLevel level);
+  // A record at |level|, written after |suppressed| records of its call
+  // site were dropped.
+  Logger(LogLevel level, std::uint64_t suppressed);
   Logger(const Logger&) = delete;
   Logger& operator=(const Logger&) = delete;
   Logger& operator=(Logger&&) = delete;
   ~Logger();
 
-  static void write(const String& message);
+  void write(StringView text) {
+    if (buffer_) append(text.data(), text.size());
+  }
+  void write(long long value);
+  void write(unsigned long long value);
+  // The shortest text that reads back as the same value.
+  void write(float value);
+  void write(double value);
+  void write(long double value);
+
+  // The start of the records at |level|, such as "|Info| ".
+  static StringView tag(LogLevel level);
+
+  static bool isEnabled(LogLevel level) {
+    return static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+  }
+  // The least severe level written. All levels are enabled by default.
+  static void setLevel(LogLevel level) {
+    level_.store(static_cast<int>(level), std::memory_order_relaxed);
+  }
+
+  // Listeners can be changed at any time, and a change does not wait for
+  // the writer. A listener removed while the writer is calling it may still
+  // get the records at hand, and is then released on the writer thread.
   static void addListener(std::shared_ptr<ILoggerListener> listener);
   static void removeListener(const std::shared_ptr<ILoggerListener>& listener);
+  // Waits until the records logged before the call, on any thread, have
+  // been written and the listeners flushed.
+  static void flush();
+  static void setOverflow(LoggerOverflow overflow);
+  // The number of records discarded because a buffer was full.
+  static std::uint64_t dropped();
 
   static Logger debug();
   static Logger error();
@@ -35,66 +171,167 @@ class Logger {
   static Logger warning();
 
  protected:
-  Logger(Logger&&) = default;
+  Logger(Logger&& other) : buffer_(other.buffer_), start_(other.start_) {
+    other.buffer_ = nullptr;
+  }
+
+ private:
+  friend class LoggerPrivate;
+
+  struct Buffer {
+    std::size_t size = 0;
+    // With room for a null character after the newline.
+    Char data[kMaxLength + 1];
+  };
+
+  // The buffer of the calling thread.
+  static Buffer& buffer();
+  void begin(StringView tag);
+  void append(const Char* text, std::size_t length) {
+    // Keeps room for the newline.
+    auto room = kMaxLength - 1 - buffer_->size;
+    if (length > room) length = room;
+    std::char_traits<Char>::copy(buffer_->data + buffer_->size, text, length);
+    buffer_->size += length;
+  }
+
+  // Null if the record is ignored.
+  Buffer* buffer_ = nullptr;
+  // Where the record starts in the buffer.
+  std::size_t start_ = 0;
+  static std::atomic<int> level_;
+};
+
+/*******************************************************************************
+ * class LogSampler
+ *
+ * The state of a YUKI_LOG_EVERY_N statement. admit() returns -1 to drop a
+ * record, or else the number of records dropped since the last one written.
+ ******************************************************************************/
+class LogSampler {
+ public:
+  constexpr explicit LogSampler(std::uint64_t n) : n_(n ? n : 1) {}
+
+  long long admit() {
+    // A load and a store rather than an atomic increment: threads logging
+    // at the same site at once may lose counts, which only shifts the
+    // sample.
+    auto count = count_.load(std::memory_order_relaxed);
+    count_.store(count + 1, std::memory_order_relaxed);
+    if (count % n_) return -1;
+    return count ? static_cast<long long>(n_ - 1) : 0;
+  }
+
+ private:
+  const std::uint64_t n_;
+  std::atomic<std::uint64_t> count_{0};
+};
+
+/*******************************************************************************
+ * class LogRateLimiter
+ *
+ * The state of a YUKI_LOG_RATE_LIMITED statement: a token bucket, kept as
+ * the time at which the next record would be on schedule. A record is
+ * dropped while that time is more than |burst| - 1 intervals ahead of
+ * std::chrono::steady_clock, which costs a clock read, relaxed loads and a
+ * store. A coarser clock would cap the rate at |burst| per tick whatever
+ * |perSecond| is. admit() returns -1 to drop a record, or else the number of
+ * records dropped since the last one written.
+ ******************************************************************************/
+class LogRateLimiter {
+ public:
+  constexpr LogRateLimiter(double perSecond, std::uint32_t burst)
+      : interval_(static_cast<std::int64_t>(1e9 / perSecond)),
+        tolerance_(static_cast<std::int64_t>(1e9 / perSecond) *
+                   (burst ? burst - 1 : 0)) {}
+
+  long long admit() {
+    auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+                   .count();
+    auto next = next_.load(std::memory_order_relaxed);
+    if (next - now > tolerance_ ||
+        !next_.compare_exchange_strong(
+            next, (next > now ? next : now) + interval_,
+            std::memory_order_relaxed)) {
+      // Like LogSampler, racing threads may lose counts.
+      suppressed_.store(suppressed_.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+      return -1;
+    }
+    return static_cast<long long>(
+        suppressed_.exchange(0, std::memory_order_relaxed));
+  }
+
+ private:
+  const std::int64_t interval_;
+  const std::int64_t tolerance_;
+  std::atomic<std::int64_t> next_{0};
+  std::atomic<std::uint64_t> suppressed_{0};
 };
 
 inline Logger& operator<<(Logger& logger, const Char c) {
-  Logger::write(String(1, c));
+  logger.write(StringView(&c, 1));
   return logger;
 }
 
 inline Logger& operator<<(Logger& logger, const Char* message) {
-  Logger::write(message);
+  logger.write(StringView(message));
   return logger;
 }
 
 inline Logger& operator<<(Logger& logger, const String& message) {
-  Logger::write(message);
+  logger.write(StringView(message));
+  return logger;
+}
+
+inline Logger& operator<<(Logger& logger, StringView message) {
+  logger.write(message);
   return logger;
 }
 
 inline Logger& operator<<(Logger& logger, const int value) {
-  logger << ToString(value);
+  logger.write(static_cast<long long>(value));
   return logger;
 }
 
 inline Logger& operator<<(Logger& logger, const long value) {
-  logger << ToString(value);
+  logger.write(static_cast<long long>(value));
   return logger;
 }
 
 inline Logger& operator<<(Logger& logger, const long long value) {
-  logger << ToString(value);
+  logger.write(value);
   return logger;
 }
 
 inline Logger& operator<<(Logger& logger, const unsigned int value) {
-  logger << ToString(value);
+  logger.write(static_cast<unsigned long long>(value));
   return logger;
 }
 
 inline Logger& operator<<(Logger& logger, const unsigned long value) {
-  logger << ToString(value);
+  logger.write(static_cast<unsigned long long>(value));
   return logger;
 }
 
 inline Logger& operator<<(Logger& logger, const unsigned long long value) {
-  logger << ToString(value);
+  logger.write(value);
   return logger;
 }
 
 inline Logger& operator<<(Logger& logger, const float value) {
-  logger << ToString(value);
+  logger.write(value);
   return logger;
 }
 
 inline Logger& operator<<(Logger& logger, const double value) {
-  logger << ToString(value);
+  logger.write(value);
   return logger;
 }
 
 inline Logger& operator<<(Logger& logger, const long double value) {
-  logger << ToString(value);
+  logger.write(value);
   return logger;
 }
 
@@ -0,0 +1,292 @@
+#include "mapped_file_logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <system_error>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace yuki {
+/*******************************************************************************
+ * class MappedFileLoggerListener::Segment
+ *
+ * A file mapped into memory as a whole. Opened with a size, the file is
+ * created anew and allocated at that size; opened without one, an existing
+ * file is mapped as it is. The file is cut to the size given to truncate()
+ * when the segment is closed.
+ ******************************************************************************/
+class MappedFileLoggerListener::Segment {
+ public:
+  Segment(const std::filesystem::path& path, std::size_t size);
+  Segment(const Segment&) = delete;
+  Segment& operator=(const Segment&) = delete;
+  ~Segment();
+
+  // Null if the file could not be mapped.
+  unsigned char* data() const { return data_; }
+  std::size_t size() const { return size_; }
+  // Starts writing [begin, end) to the disk, and waits for it if |wait| is
+  // set.
+  void sync(std::size_t begin, std::size_t end, bool wait);
+  void truncate(std::size_t size) { end_ = size; }
+
+ private:
+#ifdef _WIN32
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#else
+  int file_ = -1;
+#endif
+  unsigned char* data_ = nullptr;
+  std::size_t size_ = 0;
+  std::size_t end_ = 0;
+};
+
+#ifdef _WIN32
+MappedFileLoggerListener::Segment::Segment(const std::filesystem::path& path,
+                                           std::size_t size) {
+  file_ = ::CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                        FILE_SHARE_READ, nullptr,
+                        size ? CREATE_ALWAYS : OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_ == INVALID_HANDLE_VALUE) return;
+  LARGE_INTEGER current;
+  if (!::GetFileSizeEx(file_, &current)) return;
+  size_ = size ? size : static_cast<std::size_t>(current.QuadPart);
+  end_ = size_;
+  if (!size_) return;
+  // Mapping past the end of the file extends it.
+  ULARGE_INTEGER mapped;
+  mapped.QuadPart = size_;
+  mapping_ = ::CreateFileMappingW(file_, nullptr, PAGE_READWRITE,
+                                  mapped.HighPart, mapped.LowPart, nullptr);
+  if (!mapping_) return;
+  data_ = static_cast<unsigned char*>(
+      ::MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, size_));
+}
+
+MappedFileLoggerListener::Segment::~Segment() {
+  if (data_) ::UnmapViewOfFile(data_);
+  if (mapping_) ::CloseHandle(mapping_);
+  if (file_ == INVALID_HANDLE_VALUE) return;
+  if (end_ != size_) {
+    LARGE_INTEGER end;
+    end.QuadPart = end_;
+    ::SetFilePointerEx(file_, end, nullptr, FILE_BEGIN);
+    ::SetEndOfFile(file_);
+  }
+  ::CloseHandle(file_);
+}
+
+void MappedFileLoggerListener::Segment::sync(std::size_t begin,
+                                             std::size_t end, bool wait) {
+  if (!data_ || begin == end) return;
+  ::FlushViewOfFile(data_ + begin, end - begin);
+  if (wait) ::FlushFileBuffers(file_);
+}
+#else
+MappedFileLoggerListener::Segment::Segment(const std::filesystem::path& path,
+                                           std::size_t size) {
+  file_ = ::open(path.c_str(), size ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR,
+                 0644);
+  if (file_ < 0) return;
+  struct stat status;
+  if (::fstat(file_, &status) != 0) return;
+  size_ = size ? size : static_cast<std::size_t>(status.st_size);
+  end_ = size_;
+  if (!size_) return;
+  // Allocated up front, so that a full disk fails here rather than in a
+  // write to the mapping.
+  if (size && ::posix_fallocate(file_, 0, size) != 0) return;
+  auto data = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     file_, 0);
+  if (data != MAP_FAILED) data_ = static_cast<unsigned char*>(data);
+}
+
+MappedFileLoggerListener::Segment::~Segment() {
+  if (data_) ::munmap(data_, size_);
+  if (file_ < 0) return;
+  if (end_ != size_) {
+    // Nothing to do if it fails; the reader stops at the zeros.
+    static_cast<void>(::ftruncate(file_, end_));
+  }
+  ::close(file_);
+}
+
+void MappedFileLoggerListener::Segment::sync(std::size_t begin,
+                                             std::size_t end, bool wait) {
+  if (!data_ || begin == end) return;
+  // msync() takes a page-aligned start.
+  static const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  begin -= begin % page;
+  ::msync(data_ + begin, end - begin, wait ? MS_SYNC : MS_ASYNC);
+}
+#endif
+
+/*******************************************************************************
+ * class MappedFileLoggerListener
+ ******************************************************************************/
+MappedFileLoggerListener::MappedFileLoggerListener(
+    const std::filesystem::path& path, std::size_t segmentSize,
+    std::size_t maxSegments)
+    : directory_(path.parent_path()),
+      stem_(path.stem()),
+      extension_(path.extension()),
+      // Room for the byte order mark and a character.
+      segmentSize_(std::max(segmentSize, 2 * sizeof(Char)) / sizeof(Char) *
+                   sizeof(Char)),
+      maxSegments_(std::max<std::size_t>(maxSegments, 1)) {
+  std::error_code error;
+  if (!directory_.empty()) {
+    std::filesystem::create_directories(directory_, error);
+  }
+
+  // The segments of earlier runs, named <stem>.<sequence><extension>.
+  auto prefix = stem_.native() + std::filesystem::path::value_type('.');
+  auto& suffix = extension_.native();
+  std::filesystem::directory_iterator it(
+      directory_.empty() ? std::filesystem::path(".") : directory_, error);
+  for (; !error && it != std::filesystem::directory_iterator();
+       it.increment(error)) {
+    auto name = it->path().filename().native();
+    if (name.size() <= prefix.size() + suffix.size() ||
+        name.compare(0, prefix.size(), prefix) != 0 ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) !=
+            0) {
+      continue;
+    }
+    std::uint64_t sequence = 0;
+    auto digits = name.begin() + prefix.size();
+    auto end = name.end() - suffix.size();
+    if (!std::all_of(digits, end, [&sequence](auto c) {
+          if (c < '0' || c > '9') return false;
+          sequence = sequence * 10 + (c - '0');
+          return true;
+        })) {
+      continue;
+    }
+    sequences_.push_back(sequence);
+  }
+  std::sort(sequences_.begin(), sequences_.end());
+  if (!sequences_.empty()) recover(segment(sequences_.back()));
+  rotate();
+}
+
+MappedFileLoggerListener::~MappedFileLoggerListener() {
+  if (current_) current_->truncate(used_);
+}
+
+bool MappedFileLoggerListener::isOpen() const {
+  return current_ != nullptr;
+}
+
+void MappedFileLoggerListener::write(StringView message) {
+  if (!ready()) return;
+  auto bytes = message.size() * sizeof(Char);
+  if (used_ + bytes > segmentSize_) {
+    rotate();
+    if (!current_) return;
+    // Longer records are cut to a segment.
+    bytes = std::min(bytes, segmentSize_ - used_);
+  }
+  std::memcpy(current_->data() + used_, message.data(), bytes);
+  used_ += bytes;
+}
+
+void MappedFileLoggerListener::flush() {
+  if (!ready()) return;
+  auto now = std::chrono::steady_clock::now();
+  bool wait = now - lastSync_ >= kSyncInterval;
+  // Waiting covers what earlier flushes only started.
+  current_->sync(wait ? 0 : synced_, used_, wait);
+  synced_ = used_;
+  if (wait) lastSync_ = now;
+}
+
+bool MappedFileLoggerListener::ready() {
+  if (current_) return true;
+  if (std::chrono::steady_clock::now() - lastFailure_ < kRetryInterval) {
+    return false;
+  }
+  rotate();
+  return current_ != nullptr;
+}
+
+bool MappedFileLoggerListener::recover(const std::filesystem::path& segment) {
+  Segment file(segment, 0);
+  if (!file.data()) return false;
+  // Mappings are aligned to pages.
+  auto text = reinterpret_cast<const Char*>(file.data());
+  auto length = file.size() / sizeof(Char);
+  if (!length || text[length - 1] != Char()) return false;
+  // Skips the part of the allocation that was never written, then the
+  // record the crash cut short.
+  auto end = length;
+  while (end && text[end - 1] == Char()) {
+    --end;
+  }
+  while (end && text[end - 1] != TEXT('\n')) {
+    --end;
+  }
+  if (!end && sizeof(Char) > 1 && text[0] == static_cast<Char>(0xfeff)) {
+    end = 1;
+  }
+  file.truncate(end * sizeof(Char));
+  return true;
+}
+
+std::filesystem::path MappedFileLoggerListener::segment(
+    std::uint64_t sequence) const {
+  char digits[24];
+  std::snprintf(digits, sizeof(digits), ".%06llu",
+                static_cast<unsigned long long>(sequence));
+  auto name = stem_;
+  name += digits;
+  name += extension_;
+  return directory_ / name;
+}
+
+void MappedFileLoggerListener::rotate() {
+  if (current_) {
+    current_->truncate(used_);
+    current_.reset();
+  }
+  auto sequence = sequences_.empty() ? 1 : sequences_.back() + 1;
+  segmentPath_ = segment(sequence);
+  current_ = std::make_unique<Segment>(segmentPath_, segmentSize_);
+  used_ = 0;
+  synced_ = 0;
+  lastSync_ = std::chrono::steady_clock::now();
+  if (!current_->data()) {
+    // The file may have been created before the allocation failed. It is
+    // not one of |sequences_|, so nothing would ever remove it.
+    current_.reset();
+    std::error_code error;
+    if (std::filesystem::is_regular_file(segmentPath_, error)) {
+      std::filesystem::remove(segmentPath_, error);
+    }
+    lastFailure_ = lastSync_;
+    return;
+  }
+  sequences_.push_back(sequence);
+  while (sequences_.size() > maxSegments_) {
+    std::error_code error;
+    std::filesystem::remove(segment(sequences_.front()), error);
+    sequences_.pop_front();
+  }
+  if (sizeof(Char) > 1) {
+    auto mark = static_cast<Char>(0xfeff);
+    std::memcpy(current_->data(), &mark, sizeof(mark));
+    used_ = sizeof(mark);
+  }
+}
+
+}  // namespace yuki
@@ -0,0 +1,84 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include "core/logger.h"
+
+namespace yuki {
+/*******************************************************************************
+ * class MappedFileLoggerListener
+ *
+ * Writes text records to a series of segment files, each mapped into memory,
+ * so that writing a record is a copy into the mapping. A log at
+ * "logs/app.log" is written to "logs/app.000001.log", "logs/app.000002.log"
+ * and so on. A segment is allocated at its full size when it is opened, and
+ * cut to what was written when it is full or the listener is destroyed. Only
+ * the newest segments are kept.
+ *
+ * The characters are written as they are, after a byte order mark if they
+ * are wider than a byte. The mapping is shared with the file, so records
+ * survive the process crashing; they are pushed to the disk by flush(),
+ * which waits for the disk at most once per kSyncInterval. A segment left at
+ * full size by a crash ends with zeros; when the next listener opens the log,
+ * it cuts the segment after its last whole line.
+ *
+ * A segment that cannot be allocated or mapped, for example on a full disk,
+ * is removed again; the next write or flush() at least kRetryInterval later
+ * tries to open it anew, and records written until then are dropped.
+ ******************************************************************************/
+class MappedFileLoggerListener : public ILoggerListener {
+ public:
+  static constexpr std::size_t kSegmentSize = 16 << 20;
+  static constexpr std::size_t kMaxSegments = 8;
+  static constexpr std::chrono::seconds kSyncInterval{1};
+  static constexpr std::chrono::milliseconds kRetryInterval{100};
+
+  explicit MappedFileLoggerListener(const std::filesystem::path& path,
+                                    std::size_t segmentSize = kSegmentSize,
+                                    std::size_t maxSegments = kMaxSegments);
+  MappedFileLoggerListener(const MappedFileLoggerListener&) = delete;
+  MappedFileLoggerListener& operator=(const MappedFileLoggerListener&) =
+      delete;
+  ~MappedFileLoggerListener() override;
+
+  bool isOpen() const;
+  // The segment being written.
+  const std::filesystem::path& segmentPath() const { return segmentPath_; }
+
+  void write(StringView message) override;
+  void flush() override;
+
+  // Cuts a segment left at full size by a crash after its last whole line.
+  // Returns false if the segment cannot be read or did not need it.
+  static bool recover(const std::filesystem::path& segment);
+
+ private:
+  class Segment;
+
+  std::filesystem::path segment(std::uint64_t sequence) const;
+  void rotate();
+  // Whether a segment is open, after retrying a failed rotate() if it is
+  // time to.
+  bool ready();
+
+  std::filesystem::path directory_;
+  std::filesystem::path stem_;
+  std::filesystem::path extension_;
+  std::size_t segmentSize_;
+  std::size_t maxSegments_;
+  // The sequence numbers of the segments on disk, oldest first.
+  std::deque<std::uint64_t> sequences_;
+  std::unique_ptr<Segment> current_;
+  std::filesystem::path segmentPath_;
+  std::size_t used_ = 0;
+  // Where the last flush() stopped.
+  std::size_t synced_ = 0;
+  std::chrono::steady_clock::time_point lastSync_;
+  // When the last rotate() failed to open a segment.
+  std::chrono::steady_clock::time_point lastFailure_;
+};
+
+}  // namespace yuki
@@ -1,3 +1,24 @@
 #include "object.h"
 
-namespace yuki {}  // namespace yuki
+namespace yuki {
+/*******************************************************************************
+ * class ObjectLifetime
+ ******************************************************************************/
+std::atomic<std::uint32_t> ObjectLifetime::expirations_{0};
+
+/*******************************************************************************
+ * class Object
+ ******************************************************************************/
+Object::~Object() {
+  if (lifetime_) {
+    lifetime_->expired_.store(true, std::memory_order_release);
+    ObjectLifetime::expirations_.fetch_add(1, std::memory_order_relaxed);
+    lifetime_->release();
+  }
+}
+
+ObjectLifetime* Object::lifetime() const {
+  if (!lifetime_) lifetime_ = new ObjectLifetime;
+  return lifetime_;
+}
+}  // namespace yuki
@@ -1,13 +1,62 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
 
 namespace yuki {
+class Object;
+
+/*******************************************************************************
+ * class ObjectLifetime
+ *
+ * A weak control block: it tells whether an Object is still alive, and is
+ * itself kept alive by whoever holds a reference to it. Objects create theirs
+ * on first use, so objects nobody tracks only pay for a null pointer.
+ ******************************************************************************/
+class ObjectLifetime {
+ public:
+  ObjectLifetime(const ObjectLifetime&) = delete;
+  ObjectLifetime& operator=(const ObjectLifetime&) = delete;
+
+  bool expired() const { return expired_.load(std::memory_order_acquire); }
+  void retain() { references_.fetch_add(1, std::memory_order_relaxed); }
+  void release() {
+    if (references_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+  }
+
+  // Changes whenever a tracked object is destroyed, so that holders of many
+  // lifetimes only look at them after a change.
+  static std::uint32_t expirations() {
+    return expirations_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  ObjectLifetime() = default;
+  ~ObjectLifetime() = default;
+
+  std::atomic<bool> expired_{false};
+  // Includes the reference of the object itself.
+  std::atomic<std::uint32_t> references_{1};
+  static std::atomic<std::uint32_t> expirations_;
+  friend class Object;
+};
+
+/*******************************************************************************
+ * class Object
+ ******************************************************************************/
 class Object {
  public:
   Object() = default;
-  Object(const Object&) = default;
-  Object(Object&&) = default;
-  Object& operator=(const Object&) = default;
-  Object& operator=(Object&&) = default;
-  virtual ~Object() = default;
+  // A copy is a different object, with a lifetime of its own.
+  Object(const Object&) {}
+  Object(Object&&) noexcept {}
+  Object& operator=(const Object&) { return *this; }
+  Object& operator=(Object&&) noexcept { return *this; }
+  virtual ~Object();
+
+  // The lifetime of this object, created on first use. Not thread-safe.
+  ObjectLifetime* lifetime() const;
+
+ private:
+  mutable ObjectLifetime* lifetime_ = nullptr;
 };
 }  // namespace yuki
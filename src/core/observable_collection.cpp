@@ -0,0 +1,131 @@
+#include "observable_collection.h"
+#include <algorithm>
+
+namespace yuki {
+/*******************************************************************************
+ * class ObservableCollection
+ ******************************************************************************/
+void ObservableCollection::record(const CollectionChange& change) {
+  if (changes_.empty() || !merge(changes_.back(), change)) {
+    changes_.push_back(change);
+  } else if (!changes_.back().count) {
+    changes_.pop_back();
+  }
+  if (!batchDepth_) deliver();
+}
+
+bool ObservableCollection::merge(CollectionChange& last,
+                                 const CollectionChange& change) {
+  auto lastEnd = last.offset + last.count;
+  auto end = change.offset + change.count;
+  switch (last.kind) {
+    case CollectionChange::kInsert:
+      if (change.kind == CollectionChange::kInsert &&
+          change.offset >= last.offset && change.offset <= lastEnd) {
+        last.count += change.count;
+        return true;
+      }
+      if (change.kind == CollectionChange::kReplace &&
+          change.offset >= last.offset && end <= lastEnd) {
+        return true;
+      }
+      if (change.kind == CollectionChange::kErase &&
+          change.offset >= last.offset && end <= lastEnd) {
+        // Erasing what was just inserted; the elements were never seen.
+        last.count -= change.count;
+        return true;
+      }
+      return false;
+    case CollectionChange::kErase:
+      if (change.kind != CollectionChange::kErase) return false;
+      if (change.offset == last.offset) {
+        last.count += change.count;
+        return true;
+      }
+      if (end == last.offset) {
+        last.offset = change.offset;
+        last.count += change.count;
+        return true;
+      }
+      return false;
+    case CollectionChange::kReplace:
+      if (change.kind == CollectionChange::kReplace &&
+          change.offset <= lastEnd && end >= last.offset) {
+        last.offset = std::min(last.offset, change.offset);
+        last.count = std::max(lastEnd, end) - last.offset;
+        return true;
+      }
+      return false;
+    case CollectionChange::kMove:
+      return false;
+  }
+  return false;
+}
+
+void ObservableCollection::deliver() {
+  if (changes_.empty()) return;
+  std::vector<CollectionChange> changes;
+  changes.swap(changes_);
+  CollectionChangedEventArgs args(changes);
+  collectionChanged_.fire(this, &args);
+  // Keep the capacity for the next notification.
+  if (changes_.empty()) {
+    changes.clear();
+    changes_.swap(changes);
+  }
+}
+
+/*******************************************************************************
+ * class CollectionObserver
+ ******************************************************************************/
+void CollectionObserver::sourceChanged(
+    const std::vector<CollectionChange>& changes) {
+  // [first, last) covers every pending position, in the coordinates of the
+  // state reached so far.
+  std::size_t first = 0;
+  std::size_t last = 0;
+  auto cover = [&first, &last](std::size_t begin, std::size_t end) {
+    if (first == last) {
+      first = begin;
+      last = end;
+    } else {
+      first = std::min(first, begin);
+      last = std::max(last, end);
+    }
+  };
+  for (const auto& change : changes) {
+    auto end = change.offset + change.count;
+    switch (change.kind) {
+      case CollectionChange::kInsert:
+        if (first != last && change.offset < last) last += change.count;
+        cover(change.offset, end);
+        sourceInserted(change.offset, change.count);
+        break;
+      case CollectionChange::kErase: {
+        auto shift = [&change, end](std::size_t position) {
+          if (position >= end) return position - change.count;
+          return std::min(position, change.offset);
+        };
+        first = shift(first);
+        last = shift(last);
+        sourceErased(change.offset, change.count);
+        break;
+      }
+      case CollectionChange::kReplace:
+        cover(change.offset, end);
+        sourceReplaced(change.offset, change.count);
+        break;
+      case CollectionChange::kMove:
+        // Everything that moves stays inside the span of the two ranges.
+        if (first != last) {
+          cover(std::min(change.offset, change.destination),
+                std::max(change.offset, change.destination) + change.count);
+        }
+        sourceMoved(change.offset, change.count, change.destination);
+        break;
+    }
+  }
+  sourceSettled(first, last);
+}
+
+}  // namespace yuki
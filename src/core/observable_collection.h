@@ -0,0 +1,164 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "core/event.h"
+#include "core/object.h"
+
+namespace yuki {
+
+/*******************************************************************************
+ * struct CollectionChange
+ *
+ * One edit of an ObservableCollection, relative to the state left by the
+ * previous change of the same notification:
+ *   kInsert   [offset, offset + count) are new elements.
+ *   kErase    [offset, offset + count) of the previous state were removed.
+ *   kReplace  [offset, offset + count) were assigned new values.
+ *   kMove     [offset, offset + count) of the previous state now start at
+ *             |destination|.
+ * Values are only meaningful once the whole notification has been applied:
+ * an observer reads the new elements from the collection as it is when the
+ * notification is delivered.
+ ******************************************************************************/
+struct CollectionChange {
+  enum Kind { kInsert, kErase, kReplace, kMove };
+
+  Kind kind;
+  std::size_t offset;
+  std::size_t count;
+  std::size_t destination = 0;
+
+  bool operator==(const CollectionChange& other) const {
+    return kind == other.kind && offset == other.offset &&
+           count == other.count && destination == other.destination;
+  }
+  bool operator!=(const CollectionChange& other) const {
+    return !(*this == other);
+  }
+};
+
+// Applies a kMove change to a random access container.
+template <typename Vector>
+void moveRange(Vector& vector, std::size_t offset, std::size_t count,
+               std::size_t destination) {
+  auto first = vector.begin();
+  if (destination < offset) {
+    std::rotate(first + destination, first + offset, first + offset + count);
+  } else {
+    std::rotate(first + offset, first + offset + count,
+                first + destination + count);
+  }
+}
+
+class CollectionChangedEventArgs : public EventArgs {
+ public:
+  explicit CollectionChangedEventArgs(
+      const std::vector<CollectionChange>& changes)
+      : changes_(changes) {}
+  const std::vector<CollectionChange>& changes() const { return changes_; }
+
+ private:
+  const std::vector<CollectionChange>& changes_;
+};
+
+using CollectionChangedEventHandler =
+    EventHandler<Object*, CollectionChangedEventArgs*>;
+using CollectionChangedEvent = Event<CollectionChangedEventHandler>;
+
+/*******************************************************************************
+ * class ObservableCollection
+ *
+ * Records the edits of a collection and delivers them as range deltas.
+ * Outside of a batch each edit is delivered on its own; inside batch() the
+ * edits are collected and delivered together when the outermost batch ends.
+ * An edit that continues the previous one (appending after an insert,
+ * erasing next to an erase, replacing inside an insert or next to a
+ * replace...) is merged into it, so a feed appending thousands of items in a
+ * batch produces a single insert.
+ ******************************************************************************/
+class ObservableCollection : public Object {
+ public:
+  ObservableCollection() = default;
+  ObservableCollection(const ObservableCollection&) = delete;
+  ObservableCollection& operator=(const ObservableCollection&) = delete;
+
+  CollectionChangedEvent& collectionChanged() { return collectionChanged_; }
+
+  // Runs |f| and delivers the edits it made as a single notification.
+  template <typename F>
+  void batch(F&& f);
+
+ protected:
+  void record(const CollectionChange& change);
+
+ private:
+  static bool merge(CollectionChange& last, const CollectionChange& change);
+  void deliver();
+
+  std::vector<CollectionChange> changes_;
+  int batchDepth_ = 0;
+  CollectionChangedEvent collectionChanged_;
+};
+
+template <typename F>
+void ObservableCollection::batch(F&& f) {
+  ++batchDepth_;
+  try {
+    f();
+  } catch (...) {
+    // Whatever was applied before the exception still has to be reported.
+    if (--batchDepth_ == 0) deliver();
+    throw;
+  }
+  if (--batchDepth_ == 0) deliver();
+}
+
+/*******************************************************************************
+ * class CollectionObserver
+ *
+ * Replays the notifications of an ObservableCollection in two passes. The
+ * structural hooks see each change in order and must not read the source,
+ * which already holds the final values; inserted and replaced positions are
+ * pending until sourceSettled() is called with a range of final positions
+ * that covers all of them.
+ *
+ * The source must outlive the observer, and observe() must be called from the
+ * constructor of the class that implements the hooks. The observer
+ * disconnects from the source when it is destroyed.
+ ******************************************************************************/
+class CollectionObserver {
+ public:
+  CollectionObserver() = default;
+  CollectionObserver(const CollectionObserver&) = delete;
+  CollectionObserver& operator=(const CollectionObserver&) = delete;
+  virtual ~CollectionObserver() = default;
+
+ protected:
+  // Subscribes to |source| and replays its current elements as an insert.
+  template <typename Source>
+  void observe(Source& source);
+
+  virtual void sourceChanged(const std::vector<CollectionChange>& changes);
+  virtual void sourceInserted(std::size_t offset, std::size_t count) = 0;
+  virtual void sourceErased(std::size_t offset, std::size_t count) = 0;
+  virtual void sourceReplaced(std::size_t offset, std::size_t count) = 0;
+  virtual void sourceMoved(std::size_t offset, std::size_t count,
+                           std::size_t destination) = 0;
+  // Called once per notification, after the structural hooks.
+  virtual void sourceSettled(std::size_t first, std::size_t last) = 0;
+
+ private:
+  ScopedEventConnection connection_;
+};
+
+template <typename Source>
+void CollectionObserver::observe(Source& source) {
+  connection_ = source.collectionChanged().addHandler(
+      [this](Object*, CollectionChangedEventArgs* args) {
+        sourceChanged(args->changes());
+      });
+  sourceChanged({{CollectionChange::kInsert, 0, source.size()}});
+}
+
+}  // namespace yuki
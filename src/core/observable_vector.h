@@ -0,0 +1,98 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+#include "core/observable_collection.h"
+
+namespace yuki {
+
+/*******************************************************************************
+ * class ObservableVector
+ *
+ * A vector that reports every edit as a range delta. The elements are only
+ * exposed read-only, so that every edit goes through the methods below.
+ ******************************************************************************/
+template <typename T>
+class ObservableVector : public ObservableCollection {
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using const_iterator = typename std::vector<T>::const_iterator;
+  using const_reference = const T&;
+
+  ObservableVector() = default;
+  ObservableVector(std::initializer_list<T> values) : values_(values) {}
+  explicit ObservableVector(std::vector<T> values)
+      : values_(std::move(values)) {}
+
+  size_type size() const { return values_.size(); }
+  bool empty() const { return values_.empty(); }
+  const T& operator[](size_type index) const { return values_[index]; }
+  const T& at(size_type index) const { return values_.at(index); }
+  const T& front() const { return values_.front(); }
+  const T& back() const { return values_.back(); }
+  const_iterator begin() const { return values_.begin(); }
+  const_iterator end() const { return values_.end(); }
+  const std::vector<T>& values() const { return values_; }
+  void reserve(size_type capacity) { values_.reserve(capacity); }
+
+  template <typename... Args>
+  void emplace(size_type index, Args&&... args) {
+    values_.emplace(values_.begin() + index, std::forward<Args>(args)...);
+    record({CollectionChange::kInsert, index, 1});
+  }
+  void insert(size_type index, const T& value) { emplace(index, value); }
+  void insert(size_type index, T&& value) { emplace(index, std::move(value)); }
+  template <typename InputIt>
+  void insert(size_type index, InputIt first, InputIt last) {
+    auto count = values_.size();
+    values_.insert(values_.begin() + index, first, last);
+    count = values_.size() - count;
+    if (count) record({CollectionChange::kInsert, index, count});
+  }
+  template <typename... Args>
+  void emplace_back(Args&&... args) {
+    emplace(values_.size(), std::forward<Args>(args)...);
+  }
+  void push_back(const T& value) { emplace(values_.size(), value); }
+  void push_back(T&& value) { emplace(values_.size(), std::move(value)); }
+  template <typename InputIt>
+  void append(InputIt first, InputIt last) {
+    insert(values_.size(), first, last);
+  }
+
+  void erase(size_type index, size_type count = 1) {
+    if (!count) return;
+    auto first = values_.begin() + index;
+    values_.erase(first, first + count);
+    record({CollectionChange::kErase, index, count});
+  }
+  void pop_back() { erase(values_.size() - 1); }
+  void clear() { erase(0, values_.size()); }
+
+  void set(size_type index, T value) {
+    values_[index] = std::move(value);
+    record({CollectionChange::kReplace, index, 1});
+  }
+  // Applies |f| to the element in place and reports it as replaced.
+  template <typename F>
+  void modify(size_type index, F&& f) {
+    f(values_[index]);
+    record({CollectionChange::kReplace, index, 1});
+  }
+
+  // Moves [index, index + count) so that it starts at |destination| in the
+  // resulting vector.
+  void move(size_type index, size_type count, size_type destination) {
+    if (!count || index == destination) return;
+    moveRange(values_, index, count, destination);
+    record({CollectionChange::kMove, index, count, destination});
+  }
+
+ private:
+  std::vector<T> values_;
+};
+
+}  // namespace yuki
@@ -0,0 +1,579 @@
+#include "property.h"
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <vector>
+#include "core/property_inspector.h"
+#if YUKI_PROPERTY_STATS
+#include <chrono>
+#endif
+
+namespace yuki {
+/*******************************************************************************
+ * class PropertyEdgePool
+ ******************************************************************************/
+class PropertyEdgePool {
+ public:
+  static PropertyEdge* acquire();
+  static void release(PropertyEdge* edge);
+
+ private:
+  static constexpr std::size_t kChunkSize = 1024;
+
+  // Free edges are chained through |nextObserver|. Chunks are never handed
+  // back, so the pool holds on to the peak number of edges; it also stays
+  // valid for properties destroyed during static destruction.
+  static PropertyEdge* free;
+};
+
+PropertyEdge* PropertyEdgePool::free = nullptr;
+
+PropertyEdge* PropertyEdgePool::acquire() {
+  if (!free) {
+    auto chunk = new PropertyEdge[kChunkSize];
+    for (std::size_t i = 0; i < kChunkSize; ++i) {
+      chunk[i].nextObserver = i + 1 < kChunkSize ? &chunk[i + 1] : nullptr;
+    }
+    free = chunk;
+  }
+  auto edge = free;
+  free = edge->nextObserver;
+  return edge;
+}
+
+void PropertyEdgePool::release(PropertyEdge* edge) {
+  edge->nextObserver = free;
+  free = edge;
+}
+
+/*******************************************************************************
+ * class PropertyPropagator
+ ******************************************************************************/
+class PropertyPropagator {
+ public:
+  static void propagate(PropertyBase* source);
+  static void forget(PropertyBase* property);
+  static void beginBatch();
+  static void endBatch();
+  static void clean(PropertyBase* property);
+  static void retrack(PropertyBase* observer,
+                      std::vector<PropertyBase*>::iterator first,
+                      std::vector<PropertyBase*>::iterator last);
+  static void unlink(PropertyEdge* edge);
+
+  static PropertyBase::CycleHandler cycleHandler;
+
+ private:
+  // |pending_| of a written property during its own propagation, and of a
+  // property that has been dealt with. A property still waiting for |pending_|
+  // dependencies, or queued with none left, has a non-negative count.
+  static constexpr std::int32_t kSource =
+      std::numeric_limits<std::int32_t>::min();
+  static constexpr std::int32_t kDone = -1;
+
+  static void flush();
+  static void run();
+  static void collect();
+  static void release(PropertyBase* node, bool changed);
+  static PropertyBase* findCycle(PropertyBase* node);
+  static void reset();
+
+  // Instrumentation hooks; empty unless YUKI_PROPERTY_STATS is set.
+  static bool evaluate(PropertyBase* node);
+  static void enter(PropertyBase* node);
+  static void reach(PropertyBase* observer, const PropertyBase* node);
+  static void beginCascade();
+  static void endCascade();
+
+  static bool running;
+  static int batchDepth;
+  static std::uint64_t epoch;
+  static std::vector<PropertyBase*> written;
+  static std::vector<PropertyBase*> sources;
+  static std::vector<PropertyBase*> affected;
+  static std::vector<PropertyBase*> worklist;
+  static std::vector<PropertyBase*> pulling;
+  static std::vector<PropertyBase*> revisit;
+  static std::vector<PropertyBase*> kept;
+#if YUKI_PROPERTY_STATS
+  using Clock = std::chrono::steady_clock;
+  static PropertyCascadeStats cascade;
+  static Clock::time_point cascadeStart;
+#endif
+};
+
+PropertyBase::CycleHandler PropertyPropagator::cycleHandler;
+bool PropertyPropagator::running = false;
+int PropertyPropagator::batchDepth = 0;
+std::uint64_t PropertyPropagator::epoch = 0;
+std::vector<PropertyBase*> PropertyPropagator::written;
+std::vector<PropertyBase*> PropertyPropagator::sources;
+std::vector<PropertyBase*> PropertyPropagator::affected;
+std::vector<PropertyBase*> PropertyPropagator::worklist;
+std::vector<PropertyBase*> PropertyPropagator::pulling;
+std::vector<PropertyBase*> PropertyPropagator::revisit;
+std::vector<PropertyBase*> PropertyPropagator::kept;
+#if YUKI_PROPERTY_STATS
+PropertyCascadeStats PropertyPropagator::cascade;
+PropertyPropagator::Clock::time_point PropertyPropagator::cascadeStart;
+#endif
+
+void PropertyPropagator::propagate(PropertyBase* source) {
+  written.push_back(source);
+  // Writes inside a batch wait for its end. A binding that writes another
+  // property must not observe a half-finished propagation either; its write
+  // is replayed once the current one has settled.
+  if (batchDepth > 0 || running) return;
+  flush();
+}
+
+void PropertyPropagator::forget(PropertyBase* property) {
+  written.erase(std::remove(written.begin(), written.end(), property),
+                written.end());
+}
+
+void PropertyPropagator::beginBatch() { ++batchDepth; }
+
+void PropertyPropagator::endBatch() {
+  if (--batchDepth > 0 || running || written.empty()) return;
+  flush();
+}
+
+void PropertyPropagator::flush() {
+  running = true;
+  beginCascade();
+  try {
+    while (!written.empty()) {
+      sources.swap(written);
+      run();
+      sources.clear();
+    }
+  } catch (...) {
+    reset();
+    throw;
+  }
+  running = false;
+  endCascade();
+}
+
+void PropertyPropagator::reset() {
+  // Moving to a fresh epoch invalidates every mark left by an aborted run.
+  ++epoch;
+  written.clear();
+  sources.clear();
+  affected.clear();
+  worklist.clear();
+  revisit.clear();
+  running = false;
+}
+
+// Gathers every property reachable from the written ones and counts, for each
+// of them, the number of incoming edges from inside the affected set. Edges
+// leading into a written property are ignored: the write overrides its
+// binding. A property written more than once is kept as a single source, so
+// its observers are released for it only once.
+void PropertyPropagator::collect() {
+  auto unique = sources.begin();
+  for (auto source : sources) {
+    if (source->epoch_ == epoch) continue;
+    source->epoch_ = epoch;
+    source->pending_ = kSource;
+    enter(source);
+    worklist.push_back(source);
+    *unique++ = source;
+  }
+  sources.erase(unique, sources.end());
+  while (!worklist.empty()) {
+    auto node = worklist.back();
+    worklist.pop_back();
+    for (auto edge = node->observers_; edge; edge = edge->nextObserver) {
+      auto observer = edge->observer;
+      // A dirty lazy property has not been read since an earlier write; its
+      // dependents have already been handled then.
+      if (observer->lazy_ && observer->dirty_) continue;
+      if (observer->epoch_ != epoch) {
+        observer->epoch_ = epoch;
+        observer->pending_ = 0;
+        observer->stale_ = false;
+        enter(observer);
+        affected.push_back(observer);
+        worklist.push_back(observer);
+      } else if (observer->pending_ == kSource) {
+        continue;
+      }
+      ++observer->pending_;
+    }
+  }
+}
+
+// Counts |node| as done for its observers; |changed| marks them for
+// re-evaluation. An observer none of whose dependencies changed is skipped.
+void PropertyPropagator::release(PropertyBase* node, bool changed) {
+  for (auto edge = node->observers_; edge; edge = edge->nextObserver) {
+    auto observer = edge->observer;
+    if (observer->epoch_ != epoch || observer->pending_ < 0) continue;
+    if (changed) observer->stale_ = true;
+    reach(observer, node);
+    if (--observer->pending_ == 0) {
+      worklist.push_back(observer);
+    }
+  }
+}
+
+// Every stalled property waits on a stalled dependency, so following the
+// first such dependency always ends up on a cycle. Brent's algorithm finds a
+// property on it without marking anything; the cycle is then entered where
+// an already updated dependency feeds into it.
+PropertyBase* PropertyPropagator::findCycle(PropertyBase* node) {
+  auto stalledDependency = [](PropertyBase* property) {
+    for (auto edge = property->dependencies_; edge;
+         edge = edge->nextDependency) {
+      auto dependency = edge->dependency;
+      if (dependency->epoch_ == epoch && dependency->pending_ > 0) {
+        return dependency;
+      }
+    }
+    return property;
+  };
+  auto updatedDependency = [](PropertyBase* property) {
+    for (auto edge = property->dependencies_; edge;
+         edge = edge->nextDependency) {
+      auto dependency = edge->dependency;
+      if (dependency->epoch_ == epoch && dependency->pending_ < 0) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  std::size_t power = 1;
+  std::size_t length = 1;
+  auto tortoise = node;
+  auto hare = stalledDependency(node);
+  while (tortoise != hare) {
+    if (power == length) {
+      tortoise = hare;
+      power *= 2;
+      length = 0;
+    }
+    hare = stalledDependency(hare);
+    ++length;
+  }
+
+  auto member = hare;
+  do {
+    if (updatedDependency(member)) return member;
+    member = stalledDependency(member);
+  } while (member != hare);
+  return hare;
+}
+
+void PropertyPropagator::run() {
+  ++epoch;
+  affected.clear();
+  collect();
+  if (affected.empty()) return;
+
+  // Kahn's algorithm over the affected set: a property is evaluated only once
+  // all of its affected dependencies are up to date.
+  for (auto source : sources) {
+    release(source, true);
+  }
+  std::size_t next = 0;
+  for (;;) {
+    while (!worklist.empty()) {
+      auto node = worklist.back();
+      worklist.pop_back();
+      node->pending_ = kDone;
+      auto changed = false;
+      if (node->stale_ && node->lazy_) {
+        node->dirty_ = true;
+        changed = true;
+      } else if (node->stale_) {
+        changed = evaluate(node);
+      }
+      release(node, changed);
+    }
+    // Whatever is still pending sits on (or behind) a cycle that does not
+    // pass through a written property. Break the cycle at one of its members.
+    while (next < affected.size() && affected[next]->pending_ <= 0) ++next;
+    if (next == affected.size()) break;
+    auto node = findCycle(affected[next]);
+    if (cycleHandler) cycleHandler(node);
+    node->pending_ = 0;
+    worklist.push_back(node);
+  }
+
+  // A tracked binding that picked up a dependency before it was updated in
+  // this run is evaluated again; a change is propagated in a follow-up run.
+  for (auto node : revisit) {
+    if (node->lazy_) {
+      node->dirty_ = true;
+      written.push_back(node);
+    } else if (evaluate(node)) {
+      written.push_back(node);
+    }
+  }
+  revisit.clear();
+}
+
+// Evaluates the dirty lazy dependencies of |property| depth first, then
+// |property| itself. The explicit stack may be shared with an outer pull
+// started from a binding, hence the base index.
+void PropertyPropagator::clean(PropertyBase* property) {
+  const auto base = pulling.size();
+  // The reads of a pulled binding belong to it, not to a tracked binding that
+  // happens to be reading |property|.
+  const auto reads = PropertyBase::reads_;
+  PropertyBase::reads_ = nullptr;
+  property->dirty_ = false;
+  pulling.push_back(property);
+  try {
+    while (pulling.size() > base) {
+      auto node = pulling.back();
+      auto edge = node->dependencies_;
+      while (edge && !edge->dependency->dirty_) edge = edge->nextDependency;
+      if (edge) {
+        edge->dependency->dirty_ = false;
+        pulling.push_back(edge->dependency);
+        continue;
+      }
+      pulling.pop_back();
+      evaluate(node);
+    }
+  } catch (...) {
+    for (auto i = base; i < pulling.size(); ++i) {
+      pulling[i]->dirty_ = true;
+    }
+    pulling.resize(base);
+    PropertyBase::reads_ = reads;
+    throw;
+  }
+  PropertyBase::reads_ = reads;
+}
+
+// Replaces the dependencies of |observer| with the distinct properties in
+// [first, last). While a propagation is running, pending counts are kept in
+// line with the edges that are added or dropped.
+void PropertyPropagator::retrack(PropertyBase* observer,
+                                 std::vector<PropertyBase*>::iterator first,
+                                 std::vector<PropertyBase*>::iterator last) {
+  auto unprocessed = [](PropertyBase* property) {
+    return running && property->epoch_ == epoch && property->pending_ >= 0;
+  };
+  std::sort(first, last);
+  last = std::unique(first, last);
+
+  kept.clear();
+  for (auto edge = observer->dependencies_; edge;) {
+    auto next = edge->nextDependency;
+    auto dependency = edge->dependency;
+    if (std::binary_search(first, last, dependency)) {
+      kept.push_back(dependency);
+    } else {
+      if (unprocessed(dependency) && unprocessed(observer) &&
+          --observer->pending_ == 0) {
+        worklist.push_back(observer);
+      }
+      unlink(edge);
+    }
+    edge = next;
+  }
+  std::sort(kept.begin(), kept.end());
+
+  for (auto it = first; it != last; ++it) {
+    auto dependency = *it;
+    if (dependency == observer ||
+        std::binary_search(kept.begin(), kept.end(), dependency)) {
+      continue;
+    }
+    observer->bind(dependency);
+    if (!unprocessed(dependency)) continue;
+    if (unprocessed(observer)) {
+      ++observer->pending_;
+    } else {
+      revisit.push_back(observer);
+    }
+  }
+}
+
+void PropertyPropagator::unlink(PropertyEdge* edge) {
+  auto dependency = edge->dependency;
+  auto observer = edge->observer;
+  if (edge->prevObserver) {
+    edge->prevObserver->nextObserver = edge->nextObserver;
+  } else {
+    dependency->observers_ = edge->nextObserver;
+  }
+  if (edge->nextObserver) {
+    edge->nextObserver->prevObserver = edge->prevObserver;
+  }
+  if (edge->prevDependency) {
+    edge->prevDependency->nextDependency = edge->nextDependency;
+  } else {
+    observer->dependencies_ = edge->nextDependency;
+  }
+  if (edge->nextDependency) {
+    edge->nextDependency->prevDependency = edge->prevDependency;
+  }
+  PropertyEdgePool::release(edge);
+}
+
+#if YUKI_PROPERTY_STATS
+bool PropertyPropagator::evaluate(PropertyBase* node) {
+  auto start = Clock::now();
+  auto changed = node->evaluate();
+  std::chrono::nanoseconds elapsed = Clock::now() - start;
+  ++node->evaluations_;
+  node->evaluationTime_ += elapsed.count();
+  if (running) {
+    ++cascade.evaluated;
+    if (changed) ++cascade.changed;
+    cascade.depth = std::max<std::size_t>(cascade.depth, node->depth_);
+  }
+  return changed;
+}
+
+void PropertyPropagator::enter(PropertyBase* node) {
+  node->depth_ = 0;
+  ++cascade.touched;
+}
+
+void PropertyPropagator::reach(PropertyBase* observer,
+                               const PropertyBase* node) {
+  observer->depth_ = std::max(observer->depth_, node->depth_ + 1);
+}
+
+void PropertyPropagator::beginCascade() {
+  cascade = PropertyCascadeStats();
+  cascade.sources = written.size();
+  cascadeStart = Clock::now();
+}
+
+void PropertyPropagator::endCascade() {
+  std::chrono::nanoseconds elapsed = Clock::now() - cascadeStart;
+  cascade.nanoseconds = elapsed.count();
+  PropertyInspector::record(cascade);
+}
+#else
+bool PropertyPropagator::evaluate(PropertyBase* node) {
+  return node->evaluate();
+}
+void PropertyPropagator::enter(PropertyBase*) {}
+void PropertyPropagator::reach(PropertyBase*, const PropertyBase*) {}
+void PropertyPropagator::beginCascade() {}
+void PropertyPropagator::endCascade() {}
+#endif
+
+/*******************************************************************************
+ * class PropertyBase
+ ******************************************************************************/
+std::uint64_t PropertyBase::clock_ = 0;
+
+#if YUKI_PROPERTY_STATS
+PropertyBase* PropertyBase::live_ = nullptr;
+
+PropertyBase::PropertyBase() : nextLive_(live_) {
+  if (live_) live_->prevLive_ = this;
+  live_ = this;
+}
+#endif
+
+PropertyBase::~PropertyBase() {
+  unbind();
+  while (observers_) {
+    PropertyPropagator::unlink(observers_);
+  }
+  PropertyPropagator::forget(this);
+#if YUKI_PROPERTY_STATS
+  if (prevLive_) {
+    prevLive_->nextLive_ = nextLive_;
+  } else {
+    live_ = nextLive_;
+  }
+  if (nextLive_) nextLive_->prevLive_ = prevLive_;
+#endif
+}
+
+void PropertyBase::bind(PropertyBase* property) {
+  auto edge = PropertyEdgePool::acquire();
+  edge->dependency = property;
+  edge->observer = this;
+  edge->prevObserver = nullptr;
+  edge->nextObserver = property->observers_;
+  if (property->observers_) property->observers_->prevObserver = edge;
+  property->observers_ = edge;
+  edge->prevDependency = nullptr;
+  edge->nextDependency = dependencies_;
+  if (dependencies_) dependencies_->prevDependency = edge;
+  dependencies_ = edge;
+}
+
+void PropertyBase::unbind() {
+  while (dependencies_) {
+    PropertyPropagator::unlink(dependencies_);
+  }
+  tracked_ = false;
+}
+
+void PropertyBase::notify() {
+  if (!observers_) return;
+  PropertyPropagator::propagate(this);
+}
+
+void PropertyBase::setLazy(bool lazy) {
+  lazy_ = lazy;
+  if (!lazy_ && dirty_) clean();
+}
+
+void PropertyBase::clean() const {
+  PropertyPropagator::clean(const_cast<PropertyBase*>(this));
+}
+
+void PropertyBase::setCycleHandler(CycleHandler handler) {
+  PropertyPropagator::cycleHandler = std::move(handler);
+}
+
+/*******************************************************************************
+ * class PropertyBatch
+ ******************************************************************************/
+PropertyBatch::PropertyBatch() : exceptions_(std::uncaught_exceptions()) {
+  PropertyPropagator::beginBatch();
+}
+
+PropertyBatch::~PropertyBatch() noexcept(false) {
+  if (std::uncaught_exceptions() <= exceptions_) {
+    PropertyPropagator::endBatch();
+    return;
+  }
+  try {
+    PropertyPropagator::endBatch();
+  } catch (...) {
+  }
+}
+
+/*******************************************************************************
+ * class PropertyTracking
+ ******************************************************************************/
+namespace {
+thread_local std::vector<PropertyBase*> trackedReads;
+}  // namespace
+
+PropertyTracking::PropertyTracking(PropertyBase* observer)
+    : observer_(observer),
+      outer_(PropertyBase::reads_),
+      begin_(trackedReads.size()) {
+  PropertyBase::reads_ = &trackedReads;
+}
+
+PropertyTracking::~PropertyTracking() {
+  trackedReads.resize(begin_);
+  PropertyBase::reads_ = outer_;
+}
+
+void PropertyTracking::commit() {
+  PropertyPropagator::retrack(observer_, trackedReads.begin() + begin_,
+                              trackedReads.end());
+}
+
+}  // namespace yuki
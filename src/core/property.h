@@ -1,105 +1,546 @@
 #pragma once
-#include <algorithm>
-#include <forward_list>
+#include <cstdint>
 #include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "core/function.h"
+
+// Instruments the binding graph for PropertyInspector: a registry of live
+// properties, per-property evaluation counters and per-write cascade stats.
+// When it is 0 none of it is compiled in.
+#ifndef YUKI_PROPERTY_STATS
+#define YUKI_PROPERTY_STATS 0
+#endif
 
 namespace yuki {
 
+// The default change detection policy: values are compared with operator==
+// when the type has one, otherwise every write counts as a change.
+template <typename T, typename = void>
+struct PropertyEqual {
+  bool operator()(const T&, const T&) const { return false; }
+};
+
 template <typename T>
+struct PropertyEqual<T, std::void_t<decltype(std::declval<const T&>() ==
+                                             std::declval<const T&>())>> {
+  bool operator()(const T& a, const T& b) const { return a == b; }
+};
+
+template <typename T, typename Equal = PropertyEqual<T>>
 class Property;
+class PropertyBase;
+template <typename Derived, typename T>
+class PropertyExpression;
 
+// A dependency edge, threaded through the observer list of its dependency and
+// the dependency list of its observer. Edges come from a pool, so binding does
+// not allocate per edge and unlinking either end is O(1).
+struct PropertyEdge {
+  PropertyBase* dependency;
+  PropertyBase* observer;
+  PropertyEdge* prevObserver;
+  PropertyEdge* nextObserver;
+  PropertyEdge* prevDependency;
+  PropertyEdge* nextDependency;
+};
+
+/*******************************************************************************
+ * class PropertyBase
+ *
+ * A write to a property propagates to every property that transitively
+ * observes it. The propagation collects the affected set first and then
+ * evaluates each dependent exactly once in topological order, so a diamond
+ * (a -> b, a -> c, b + c -> d) never exposes an intermediate value of `d`.
+ * Propagation runs on an explicit worklist, so its stack usage does not
+ * depend on the length of a binding chain.
+ *
+ * A write or re-evaluation that leaves the value equal to the old one does not
+ * propagate any further. Every actual change stamps the property with a
+ * version from a global clock, so a consumer can check whether a property has
+ * changed since it last looked without subscribing to it.
+ *
+ * A tracked binding has no fixed dependency list. Every property read through
+ * get() while it evaluates becomes a dependency, and dependencies that were
+ * not read by the latest evaluation are dropped.
+ *
+ * A lazy property is not evaluated by the propagation. It is only marked
+ * dirty and recomputes on the next read, so bindings nobody reads cost a flag
+ * flip per write.
+ ******************************************************************************/
 class PropertyBase {
  public:
+  // Called with a property on a binding cycle that does not pass through the
+  // written property. The cycle is broken there and propagation goes on.
+  using CycleHandler = std::function<void(PropertyBase* property)>;
+
+#if YUKI_PROPERTY_STATS
+  PropertyBase();
+#else
   PropertyBase() = default;
-  virtual ~PropertyBase() {
-    for (const auto& observer : observers_) {
-      auto& dependencies = observer->dependencies_;
-      dependencies.remove(this);
-    }
-  }
+#endif
+  PropertyBase& operator=(const PropertyBase&) = delete;
+  virtual ~PropertyBase();
 
-  void notify() { notify(this); }
-  virtual void evaluate(PropertyBase* source) = 0;
-  void unbind() {
-    for (auto dependency : dependencies_) {
-      auto& observers = dependency->observers_;
-      observers.remove(this);
-    }
-  }
+  void notify();
+  // Recomputes the value from the binding; returns whether it changed.
+  virtual bool evaluate() = 0;
+  static void setCycleHandler(CycleHandler handler);
+  template <typename F>
+  static void batch(F&& f);
+  bool isLazy() const { return lazy_; }
+  void setLazy(bool lazy);
+  bool isDirty() const { return dirty_; }
+  bool isTracked() const { return tracked_; }
+  // The clock value of the last change. For a lazy property, the last change
+  // it has computed.
+  std::uint64_t version() const { return version_; }
+  bool changedSince(std::uint64_t version) const { return version_ > version; }
+  static std::uint64_t currentVersion() { return clock_; }
+  void unbind();
+  // Labels the property in PropertyInspector dumps; a no-op unless
+  // YUKI_PROPERTY_STATS is set.
+#if YUKI_PROPERTY_STATS
+  void setName(std::string name) { name_ = std::move(name); }
+  const std::string& name() const { return name_; }
+#else
+  template <typename S>
+  void setName(S&&) {}
+#endif
 
  protected:
-  void notify(PropertyBase* source) {
-    for (auto observer : observers_) {
-      observer->evaluate(source);
-    }
-  }
-  void bind(PropertyBase* property) {
-    dependencies_.emplace_front(property);
-    property->observers_.emplace_front(this);
+  // A copy starts out unbound and unobserved.
+  PropertyBase(const PropertyBase&) : PropertyBase() {}
+
+  // Brings a dirty lazy property, and the dirty lazy properties it depends on,
+  // up to date.
+  void clean() const;
+  void bind(PropertyBase* property);
+  void touch() { version_ = ++clock_; }
+  void track() const {
+    if (reads_) reads_->push_back(const_cast<PropertyBase*>(this));
   }
 
  protected:
-  std::forward_list<PropertyBase*> observers_;
-  std::forward_list<PropertyBase*> dependencies_;
-  template <typename T>
+  PropertyEdge* observers_ = nullptr;
+  PropertyEdge* dependencies_ = nullptr;
+  template <typename T, typename Equal>
   friend class Property;
+  friend class PropertyPropagator;
+  friend class PropertyTracking;
+  friend class PropertyInspector;
+  friend class PropertyStore;
+
+ private:
+  // Per-write propagation state, owned by PropertyPropagator. |pending_| is
+  // only meaningful while |epoch_| matches the running propagation.
+  std::uint64_t epoch_ = 0;
+  std::int32_t pending_ = 0;
+  bool lazy_ = false;
+  bool dirty_ = false;
+  // Set once a dependency has changed during the running propagation.
+  bool stale_ = false;
+  bool tracked_ = false;
+  std::uint64_t version_ = 0;
+
+  static std::uint64_t clock_;
+  // Where get() records reads while a tracked binding evaluates on this
+  // thread; null otherwise.
+  inline static thread_local std::vector<PropertyBase*>* reads_ = nullptr;
+
+#if YUKI_PROPERTY_STATS
+  std::string name_;
+  std::uint64_t evaluations_ = 0;
+  std::uint64_t evaluationTime_ = 0;
+  // The length of the longest path from a written property in the running
+  // propagation.
+  std::uint32_t depth_ = 0;
+  // The registry of live properties.
+  PropertyBase* prevLive_ = nullptr;
+  PropertyBase* nextLive_ = nullptr;
+  static PropertyBase* live_;
+#endif
 };
 
-template <typename T>
+/*******************************************************************************
+ * class PropertyTracking
+ *
+ * Records the reads of a tracked binding while it is alive. commit() turns
+ * them into the dependency list of |observer|. Leaving the scope without a
+ * commit, e.g. because the binding threw, keeps the previous dependencies.
+ ******************************************************************************/
+class PropertyTracking {
+ public:
+  explicit PropertyTracking(PropertyBase* observer);
+  PropertyTracking(const PropertyTracking&) = delete;
+  PropertyTracking& operator=(const PropertyTracking&) = delete;
+  ~PropertyTracking();
+
+  void commit();
+
+ private:
+  PropertyBase* observer_;
+  std::vector<PropertyBase*>* outer_;
+  std::size_t begin_;
+};
+
+/*******************************************************************************
+ * class PropertyBatch
+ *
+ * Defers the propagation of every write made while the scope is alive. When
+ * the outermost batch ends, all written properties are propagated together,
+ * so each dependent is evaluated once and sees the final values. A written
+ * property keeps the written value even if it is bound to another property
+ * written in the same batch.
+ *
+ * Writes are committed on unwinding as well. An exception thrown by a
+ * binding while committing is rethrown, unless the batch is being left by
+ * an exception already, in which case it is dropped.
+ ******************************************************************************/
+class PropertyBatch {
+ public:
+  PropertyBatch();
+  PropertyBatch(const PropertyBatch&) = delete;
+  PropertyBatch& operator=(const PropertyBatch&) = delete;
+  ~PropertyBatch() noexcept(false);
+
+ private:
+  int exceptions_;
+};
+
+template <typename F>
+void PropertyBase::batch(F&& f) {
+  PropertyBatch batch;
+  std::forward<F>(f)();
+}
+
+template <typename T, typename Equal>
 class Property : public PropertyBase {
  public:
-  using Binding = std::function<T()>;
+  using Binding = InlineFunction<T()>;
   Property() = default;
   ~Property() = default;
-  template <typename U>
-  Property(const Property<U>& value) {
+  Property(const Property& value) : PropertyBase(), value_(value.get()) {}
+  template <typename U, typename E>
+  Property(const Property<U, E>& value) {
     value_ = value.get();
   }
   Property(const T& t) : value_(t) {}
   Property(T&& value) : value_(std::move(value)) {}
 
   // setters
+  void operator=(const Property& value) { operator=(value.get()); }
   void operator=(const T& t) {
+    if (!dirty_ && Equal()(value_, t)) return;
     value_ = t;
+    dirty_ = false;
+    touch();
     notify();
   }
   void operator=(T&& t) {
+    if (!dirty_ && Equal()(value_, t)) return;
     value_ = std::move(t);
+    dirty_ = false;
+    touch();
     notify();
   }
 
   // getters
-  const T& get() const { return value_; }
+  const T& get() const {
+    if (dirty_) clean();
+    track();
+    return value_;
+  }
   const T& operator()() const { return get(); }
   operator const T&() const { return get(); }
 
   // bind
-  template <typename U>
-  void bind(Property<U>& value) {
-    PropertyBase::bind(&value);
-    operator=(value.get());
-    binding_ = [&]() { return value.get(); };
-  }
-  template <typename... Args>
-  void bind(Binding binding, Property<Args>&... args) {
+  template <typename U, typename E>
+  void bind(Property<U, E>& value) {
+    bind([&value]() -> T { return value.get(); }, value);
+  }
+  template <typename... Args, typename... Equals>
+  void bind(Binding binding, Property<Args, Equals>&... args) {
+    unbind();
     { [[maybe_unused]] int unused[] = {0, ((void)PropertyBase::bind(&args), 0)...}; }
-    binding_ = binding;
-    evaluate(this);
+    setBinding(std::move(binding));
+  }
+  // Binds to an expression such as `a + b * 2`, see PropertyExpression.
+  template <typename E, typename V>
+  void bind(const PropertyExpression<E, V>& expression) {
+    const auto& e = static_cast<const E&>(expression);
+    unbind();
+    e.forEachProperty([this](const PropertyBase& p) {
+      PropertyBase::bind(const_cast<PropertyBase*>(&p));
+    });
+    setBinding([e]() -> T { return e.value(); });
+  }
+  // Binds to whatever properties |binding| reads, see PropertyBase.
+  void bindTracked(Binding binding) {
+    unbind();
+    tracked_ = true;
+    setBinding(std::move(binding));
   }
 
   // evaluate
-  virtual void evaluate(PropertyBase* source) override {
-    if (binding_) {
-      value_ = binding_();
-      if (source != this) {
-        notify(source);
-      }
+  virtual bool evaluate() override {
+    if (!binding_) return false;
+    if (!tracked_) return update(binding_());
+    PropertyTracking tracking(this);
+    T value = binding_();
+    tracking.commit();
+    return update(std::move(value));
+  }
+
+ private:
+  void setBinding(Binding binding) {
+    binding_ = std::move(binding);
+    if (lazy_) {
+      dirty_ = true;
+      notify();
+    } else if (evaluate()) {
+      notify();
     }
   }
+  bool update(T&& value) {
+    if (Equal()(value_, value)) return false;
+    value_ = std::move(value);
+    touch();
+    return true;
+  }
 
  protected:
-  T value_;
+  T value_{};
   Binding binding_;
 };
 
+/*******************************************************************************
+ * class PropertyExpression
+ *
+ * Arithmetic, comparisons and logic on properties build an expression tree
+ * instead of a value. Binding a property to an expression subscribes it to
+ * every property in the tree and evaluates the tree inline, without a
+ * hand-written dependency list:
+ *
+ *   c.bind(a + b * 2);
+ *   visible.bind(select(width > 0, opacity, 0.0f));
+ *   x.bind(project(position, &Point::x));
+ *
+ * An expression converts to its value, so `a + b` can still be used where a
+ * plain value is expected. Properties are held by reference and everything
+ * else by value.
+ ******************************************************************************/
+template <typename Derived, typename T>
+class PropertyExpression {
+ public:
+  using ValueType = T;
+  operator T() const { return static_cast<const Derived&>(*this).value(); }
+};
+
+template <typename E>
+using PropertyValueType =
+    std::decay_t<decltype(std::declval<const E&>().value())>;
+
+template <typename P>
+class PropertyReference
+    : public PropertyExpression<
+          PropertyReference<P>,
+          std::decay_t<decltype(std::declval<P&>().get())>> {
+ public:
+  explicit PropertyReference(P& property) : property_(&property) {}
+  const auto& value() const { return property_->get(); }
+  template <typename F>
+  void forEachProperty(F&& f) const {
+    f(*property_);
+  }
+
+ private:
+  P* property_;
+};
+
+template <typename T>
+class PropertyConstant
+    : public PropertyExpression<PropertyConstant<T>, T> {
+ public:
+  explicit PropertyConstant(T value) : value_(std::move(value)) {}
+  const T& value() const { return value_; }
+  template <typename F>
+  void forEachProperty(F&&) const {}
+
+ private:
+  T value_;
+};
+
+template <typename Op, typename E>
+class PropertyUnaryExpression
+    : public PropertyExpression<
+          PropertyUnaryExpression<Op, E>,
+          std::decay_t<decltype(Op()(std::declval<const E&>().value()))>> {
+ public:
+  explicit PropertyUnaryExpression(E operand) : operand_(std::move(operand)) {}
+  auto value() const { return Op()(operand_.value()); }
+  template <typename F>
+  void forEachProperty(F&& f) const {
+    operand_.forEachProperty(f);
+  }
+
+ private:
+  E operand_;
+};
+
+template <typename Op, typename L, typename R>
+class PropertyBinaryExpression
+    : public PropertyExpression<
+          PropertyBinaryExpression<Op, L, R>,
+          std::decay_t<decltype(Op()(std::declval<const L&>().value(),
+                                     std::declval<const R&>().value()))>> {
+ public:
+  PropertyBinaryExpression(L left, R right)
+      : left_(std::move(left)), right_(std::move(right)) {}
+  auto value() const { return Op()(left_.value(), right_.value()); }
+  template <typename F>
+  void forEachProperty(F&& f) const {
+    left_.forEachProperty(f);
+    right_.forEachProperty(f);
+  }
+
+ private:
+  L left_;
+  R right_;
+};
+
+template <typename C, typename A, typename B>
+class PropertySelectExpression
+    : public PropertyExpression<
+          PropertySelectExpression<C, A, B>,
+          std::common_type_t<PropertyValueType<A>, PropertyValueType<B>>> {
+ public:
+  using ValueType =
+      std::common_type_t<PropertyValueType<A>, PropertyValueType<B>>;
+
+  PropertySelectExpression(C condition, A a, B b)
+      : condition_(std::move(condition)), a_(std::move(a)), b_(std::move(b)) {}
+  ValueType value() const {
+    if (condition_.value()) return a_.value();
+    return b_.value();
+  }
+  template <typename F>
+  void forEachProperty(F&& f) const {
+    condition_.forEachProperty(f);
+    a_.forEachProperty(f);
+    b_.forEachProperty(f);
+  }
+
+ private:
+  C condition_;
+  A a_;
+  B b_;
+};
+
+template <typename E, typename M>
+class PropertyProjection
+    : public PropertyExpression<
+          PropertyProjection<E, M>,
+          std::decay_t<std::invoke_result_t<
+              M, decltype(std::declval<const E&>().value())>>> {
+ public:
+  PropertyProjection(E operand, M member)
+      : operand_(std::move(operand)), member_(member) {}
+  auto value() const { return std::invoke(member_, operand_.value()); }
+  template <typename F>
+  void forEachProperty(F&& f) const {
+    operand_.forEachProperty(f);
+  }
+
+ private:
+  E operand_;
+  M member_;
+};
+
+// Whether X takes part in building an expression: a property or an
+// expression node.
+template <typename X, typename = void>
+struct IsPropertyOperand : std::false_type {};
+
+template <typename X>
+struct IsPropertyOperand<
+    X, std::enable_if_t<std::is_base_of<PropertyBase, X>::value>>
+    : std::true_type {};
+
+template <typename X>
+struct IsPropertyOperand<
+    X, std::enable_if_t<std::is_base_of<
+           PropertyExpression<X, typename X::ValueType>, X>::value>>
+    : std::true_type {};
+
+// Wraps a property, an expression or a plain value as an expression node.
+template <typename X>
+auto makePropertyOperand(const X& x) {
+  if constexpr (std::is_base_of<PropertyBase, X>::value) {
+    return PropertyReference<const X>(x);
+  } else if constexpr (IsPropertyOperand<X>::value) {
+    return x;
+  } else {
+    return PropertyConstant<X>(x);
+  }
+}
+
+template <typename X>
+using PropertyOperand = decltype(makePropertyOperand(std::declval<const X&>()));
+
+#define YUKI_PROPERTY_UNARY_OPERATOR(op, Op)                                 \
+  template <typename X,                                                      \
+            typename = std::enable_if_t<IsPropertyOperand<X>::value>>         \
+  auto operator op(const X& x) {                                             \
+    return PropertyUnaryExpression<Op, PropertyOperand<X>>(                   \
+        makePropertyOperand(x));                                             \
+  }
+
+#define YUKI_PROPERTY_BINARY_OPERATOR(op, Op)                                \
+  template <typename L, typename R,                                          \
+            typename = std::enable_if_t<IsPropertyOperand<L>::value ||        \
+                                        IsPropertyOperand<R>::value>>         \
+  auto operator op(const L& l, const R& r) {                                 \
+    return PropertyBinaryExpression<Op, PropertyOperand<L>,                  \
+                                    PropertyOperand<R>>(                     \
+        makePropertyOperand(l), makePropertyOperand(r));                     \
+  }
+
+YUKI_PROPERTY_UNARY_OPERATOR(-, std::negate<>)
+YUKI_PROPERTY_UNARY_OPERATOR(!, std::logical_not<>)
+YUKI_PROPERTY_BINARY_OPERATOR(+, std::plus<>)
+YUKI_PROPERTY_BINARY_OPERATOR(-, std::minus<>)
+YUKI_PROPERTY_BINARY_OPERATOR(*, std::multiplies<>)
+YUKI_PROPERTY_BINARY_OPERATOR(/, std::divides<>)
+YUKI_PROPERTY_BINARY_OPERATOR(%, std::modulus<>)
+YUKI_PROPERTY_BINARY_OPERATOR(==, std::equal_to<>)
+YUKI_PROPERTY_BINARY_OPERATOR(!=, std::not_equal_to<>)
+YUKI_PROPERTY_BINARY_OPERATOR(<, std::less<>)
+YUKI_PROPERTY_BINARY_OPERATOR(<=, std::less_equal<>)
+YUKI_PROPERTY_BINARY_OPERATOR(>, std::greater<>)
+YUKI_PROPERTY_BINARY_OPERATOR(>=, std::greater_equal<>)
+YUKI_PROPERTY_BINARY_OPERATOR(&&, std::logical_and<>)
+YUKI_PROPERTY_BINARY_OPERATOR(||, std::logical_or<>)
+
+#undef YUKI_PROPERTY_UNARY_OPERATOR
+#undef YUKI_PROPERTY_BINARY_OPERATOR
+
+// `condition ? a : b` as an expression.
+template <typename C, typename A, typename B>
+auto select(const C& condition, const A& a, const B& b) {
+  return PropertySelectExpression<PropertyOperand<C>, PropertyOperand<A>,
+                                  PropertyOperand<B>>(
+      makePropertyOperand(condition), makePropertyOperand(a),
+      makePropertyOperand(b));
+}
+
+// A data member or getter of the value of |x|, e.g. project(rect, &Rect::x).
+template <typename X, typename M>
+auto project(const X& x, M member) {
+  return PropertyProjection<PropertyOperand<X>, M>(makePropertyOperand(x),
+                                                   member);
+}
+
 }  // namespace yuki
@@ -0,0 +1,168 @@
+#include "property_inspector.h"
+
+#if YUKI_PROPERTY_STATS
+#include <cstdio>
+#include <unordered_map>
+
+namespace yuki {
+namespace {
+
+std::string quote(const std::string& text) {
+  std::string result = "\"";
+  for (auto c : text) {
+    switch (c) {
+      case '"':
+        result += "\\\"";
+        break;
+      case '\\':
+        result += "\\\\";
+        break;
+      case '\n':
+        result += "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          result += escaped;
+        } else {
+          result += c;
+        }
+    }
+  }
+  return result + "\"";
+}
+
+// Escapes |text| for the inside of a DOT quoted string, where a backslash
+// starts an escape of its own and "\n" is a line break.
+std::string escapeDot(const std::string& text) {
+  std::string result;
+  for (auto c : text) {
+    switch (c) {
+      case '"':
+        result += "\\\"";
+        break;
+      case '\\':
+        result += "\\\\";
+        break;
+      case '\n':
+        result += "\\n";
+        break;
+      default:
+        result += c;
+    }
+  }
+  return result;
+}
+
+// Visits every live property and numbers them in order.
+template <typename F>
+void forEachLive(F&& f) {
+  std::size_t id = 0;
+  for (auto node : PropertyInspector::nodes()) {
+    f(id++, node);
+  }
+}
+
+}  // namespace
+
+/*******************************************************************************
+ * class PropertyInspector
+ ******************************************************************************/
+PropertyCascadeStats PropertyInspector::last;
+PropertyInspector::CascadeHandler PropertyInspector::cascadeHandler;
+
+PropertyNodeStats PropertyInspector::stats(const PropertyBase& property) {
+  PropertyNodeStats stats;
+  stats.property = &property;
+  stats.name = property.name_;
+  stats.evaluations = property.evaluations_;
+  stats.nanoseconds = property.evaluationTime_;
+  stats.fanIn = 0;
+  for (auto edge = property.dependencies_; edge; edge = edge->nextDependency) {
+    ++stats.fanIn;
+  }
+  stats.fanOut = 0;
+  for (auto edge = property.observers_; edge; edge = edge->nextObserver) {
+    ++stats.fanOut;
+  }
+  stats.lazy = property.lazy_;
+  stats.dirty = property.dirty_;
+  stats.tracked = property.tracked_;
+  return stats;
+}
+
+std::vector<PropertyNodeStats> PropertyInspector::nodes() {
+  std::vector<PropertyNodeStats> result;
+  for (auto node = PropertyBase::live_; node; node = node->nextLive_) {
+    result.push_back(stats(*node));
+  }
+  return result;
+}
+
+const PropertyCascadeStats& PropertyInspector::lastCascade() { return last; }
+
+void PropertyInspector::setCascadeHandler(CascadeHandler handler) {
+  cascadeHandler = std::move(handler);
+}
+
+void PropertyInspector::resetCounters() {
+  for (auto node = PropertyBase::live_; node; node = node->nextLive_) {
+    node->evaluations_ = 0;
+    node->evaluationTime_ = 0;
+  }
+}
+
+void PropertyInspector::record(const PropertyCascadeStats& cascade) {
+  last = cascade;
+  if (cascadeHandler) cascadeHandler(cascade);
+}
+
+void PropertyInspector::dumpDot(std::ostream& out) {
+  std::unordered_map<const PropertyBase*, std::size_t> ids;
+  out << "digraph properties {\n";
+  forEachLive([&out, &ids](std::size_t id, const PropertyNodeStats& node) {
+    ids[node.property] = id;
+    auto name = node.name.empty() ? "#" + std::to_string(id) : node.name;
+    out << "  n" << id << " [label=\"" << escapeDot(name) << "\\n"
+        << node.evaluations << " evals, " << node.nanoseconds / 1000
+        << " us\"";
+    if (node.lazy) out << ", style=dashed";
+    out << "];\n";
+  });
+  for (auto node = PropertyBase::live_; node; node = node->nextLive_) {
+    for (auto edge = node->observers_; edge; edge = edge->nextObserver) {
+      out << "  n" << ids[node] << " -> n" << ids[edge->observer] << ";\n";
+    }
+  }
+  out << "}\n";
+}
+
+void PropertyInspector::dumpJson(std::ostream& out) {
+  std::unordered_map<const PropertyBase*, std::size_t> ids;
+  out << "{\"nodes\": [";
+  forEachLive([&out, &ids](std::size_t id, const PropertyNodeStats& node) {
+    ids[node.property] = id;
+    out << (id ? ", " : "") << "{\"id\": " << id
+        << ", \"name\": " << quote(node.name)
+        << ", \"evaluations\": " << node.evaluations
+        << ", \"nanoseconds\": " << node.nanoseconds
+        << ", \"fanIn\": " << node.fanIn << ", \"fanOut\": " << node.fanOut
+        << ", \"lazy\": " << (node.lazy ? "true" : "false")
+        << ", \"dirty\": " << (node.dirty ? "true" : "false")
+        << ", \"tracked\": " << (node.tracked ? "true" : "false") << "}";
+  });
+  out << "], \"edges\": [";
+  auto first = true;
+  for (auto node = PropertyBase::live_; node; node = node->nextLive_) {
+    for (auto edge = node->observers_; edge; edge = edge->nextObserver) {
+      out << (first ? "" : ", ") << "[" << ids[node] << ", "
+          << ids[edge->observer] << "]";
+      first = false;
+    }
+  }
+  out << "]}\n";
+}
+
+}  // namespace yuki
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+#include "core/property.h"
+
+#if YUKI_PROPERTY_STATS
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace yuki {
+
+struct PropertyNodeStats {
+  const PropertyBase* property;
+  std::string name;
+  // Evaluations by propagation and by lazy reads, and their total wall time
+  // in nanoseconds. Time spent pulling lazy dependencies is included.
+  std::uint64_t evaluations;
+  std::uint64_t nanoseconds;
+  std::size_t fanIn;
+  std::size_t fanOut;
+  bool lazy;
+  bool dirty;
+  bool tracked;
+};
+
+// One write, or one batch, and everything it set off.
+struct PropertyCascadeStats {
+  std::size_t sources = 0;
+  // Properties reached, including lazy ones only marked dirty.
+  std::size_t touched = 0;
+  std::size_t evaluated = 0;
+  std::size_t changed = 0;
+  // The longest chain of updates from a written property.
+  std::size_t depth = 0;
+  std::uint64_t nanoseconds = 0;
+};
+
+/*******************************************************************************
+ * class PropertyInspector
+ *
+ * A view of the live binding graph, for finding hot properties and writes
+ * with large cascades. Only available when YUKI_PROPERTY_STATS is set, e.g.
+ * in debug builds.
+ ******************************************************************************/
+class PropertyInspector {
+ public:
+  using CascadeHandler = std::function<void(const PropertyCascadeStats&)>;
+
+  static PropertyNodeStats stats(const PropertyBase& property);
+  // Every live property, most recently created first.
+  static std::vector<PropertyNodeStats> nodes();
+  static const PropertyCascadeStats& lastCascade();
+  // Called after every cascade; keep it cheap.
+  static void setCascadeHandler(CascadeHandler handler);
+  // Zeroes the evaluation counters of every live property.
+  static void resetCounters();
+
+  // Graphviz, with an edge from each dependency to its observers.
+  static void dumpDot(std::ostream& out);
+  // {"nodes": [{"id", "name", "evaluations", ...}], "edges": [[from, to]]}
+  static void dumpJson(std::ostream& out);
+
+ private:
+  static void record(const PropertyCascadeStats& cascade);
+
+  static PropertyCascadeStats last;
+  static CascadeHandler cascadeHandler;
+  friend class PropertyPropagator;
+};
+
+}  // namespace yuki
+#endif
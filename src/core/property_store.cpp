@@ -0,0 +1,58 @@
+#include "property_store.h"
+#include <algorithm>
+
+namespace yuki {
+/*******************************************************************************
+ * class PropertyDescriptorBase
+ ******************************************************************************/
+namespace {
+// Zero-initialized before any dynamic initialization, so descriptors defined
+// as statics in other translation units can take ids in any order.
+std::uint32_t nextDescriptorId;
+}  // namespace
+
+PropertyDescriptorBase::PropertyDescriptorBase(const char* name)
+    : name_(name), id_(nextDescriptorId++) {}
+
+/*******************************************************************************
+ * class PropertyStore
+ ******************************************************************************/
+PropertyStore::~PropertyStore() {
+  for (auto& entry : entries_) {
+    delete entry.property;
+  }
+}
+
+PropertyBase* PropertyStore::find(std::uint32_t id) const {
+  auto it = std::lower_bound(
+      entries_.begin(), entries_.end(), id,
+      [](const Entry& entry, std::uint32_t id) { return entry.id < id; });
+  return it != entries_.end() && it->id == id ? it->property : nullptr;
+}
+
+void PropertyStore::insert(std::uint32_t id, PropertyBase* property) {
+  auto it = std::lower_bound(
+      entries_.begin(), entries_.end(), id,
+      [](const Entry& entry, std::uint32_t id) { return entry.id < id; });
+  // Tables stay small; grow them exactly rather than geometrically.
+  if (entries_.size() == entries_.capacity()) {
+    std::vector<Entry> entries;
+    entries.reserve(entries_.size() + 1);
+    entries.insert(entries.end(), entries_.begin(), it);
+    entries.push_back({id, property});
+    entries.insert(entries.end(), it, entries_.end());
+    entries_.swap(entries);
+    return;
+  }
+  entries_.insert(it, {id, property});
+}
+
+void PropertyStore::erase(std::uint32_t id) {
+  auto it = std::lower_bound(
+      entries_.begin(), entries_.end(), id,
+      [](const Entry& entry, std::uint32_t id) { return entry.id < id; });
+  delete it->property;
+  entries_.erase(it);
+}
+
+}  // namespace yuki
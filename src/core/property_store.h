@@ -0,0 +1,153 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "core/property.h"
+
+namespace yuki {
+
+/*******************************************************************************
+ * class PropertyDescriptor
+ *
+ * Describes a property kept in a PropertyStore: its name, its value type and
+ * the default value every store reports until the property is set or bound.
+ * Descriptors are meant to be static members of the class they describe:
+ *
+ *   class Button : public PropertyStore {
+ *    public:
+ *     static const PropertyDescriptor<float> kWidth;
+ *   };
+ *   const PropertyDescriptor<float> Button::kWidth("width", 100.f);
+ ******************************************************************************/
+class PropertyDescriptorBase {
+ public:
+  PropertyDescriptorBase(const PropertyDescriptorBase&) = delete;
+  PropertyDescriptorBase& operator=(const PropertyDescriptorBase&) = delete;
+
+  std::uint32_t id() const { return id_; }
+  const char* name() const { return name_; }
+
+ protected:
+  explicit PropertyDescriptorBase(const char* name);
+
+ private:
+  const char* name_;
+  std::uint32_t id_;
+};
+
+template <typename T, typename Equal = PropertyEqual<T>>
+class PropertyDescriptor : public PropertyDescriptorBase {
+ public:
+  using PropertyType = Property<T, Equal>;
+
+  explicit PropertyDescriptor(const char* name, T defaultValue = T())
+      : PropertyDescriptorBase(name), defaultValue_(std::move(defaultValue)) {}
+
+  const T& defaultValue() const { return defaultValue_; }
+
+ private:
+  T defaultValue_;
+};
+
+/*******************************************************************************
+ * class PropertyStore
+ *
+ * Sparse storage for the properties of an object. Only the properties that
+ * are set, bound or observed have an entry, in a table sorted by descriptor
+ * id; all others read as the default of their descriptor. An object with no
+ * local values costs the size of an empty vector.
+ *
+ * property() creates the entry, so that it can be bound or observed. A read
+ * from within a tracked binding does the same, so the binding sees later
+ * changes to the property.
+ ******************************************************************************/
+class PropertyStore {
+ public:
+  PropertyStore() = default;
+  PropertyStore(const PropertyStore&) = delete;
+  PropertyStore& operator=(const PropertyStore&) = delete;
+  virtual ~PropertyStore();
+
+  template <typename T, typename Equal>
+  const T& get(const PropertyDescriptor<T, Equal>& descriptor) const;
+  template <typename T, typename Equal, typename U>
+  void set(const PropertyDescriptor<T, Equal>& descriptor, U&& value) {
+    property(descriptor) = std::forward<U>(value);
+  }
+  template <typename T, typename Equal, typename... Args>
+  void bind(const PropertyDescriptor<T, Equal>& descriptor, Args&&... args) {
+    property(descriptor).bind(std::forward<Args>(args)...);
+  }
+  // The property itself, created with the default value if needed.
+  template <typename T, typename Equal>
+  Property<T, Equal>& property(const PropertyDescriptor<T, Equal>& descriptor);
+
+  // Whether the property has an entry.
+  bool has(const PropertyDescriptorBase& descriptor) const {
+    return find(descriptor.id()) != nullptr;
+  }
+  // Reverts the property to its default. The entry is dropped unless other
+  // properties observe it, in which case it is unbound and reset instead.
+  template <typename T, typename Equal>
+  void clear(const PropertyDescriptor<T, Equal>& descriptor);
+  // The number of entries.
+  std::size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    std::uint32_t id;
+    PropertyBase* property;
+  };
+
+  PropertyBase* find(std::uint32_t id) const;
+  void insert(std::uint32_t id, PropertyBase* property);
+  void erase(std::uint32_t id);
+  static bool isTracking() { return PropertyBase::reads_ != nullptr; }
+  static bool isObserved(const PropertyBase* property) {
+    return property->observers_ != nullptr;
+  }
+
+  std::vector<Entry> entries_;
+};
+
+template <typename T, typename Equal>
+const T& PropertyStore::get(
+    const PropertyDescriptor<T, Equal>& descriptor) const {
+  using PropertyType = Property<T, Equal>;
+  if (auto property = find(descriptor.id())) {
+    return static_cast<const PropertyType*>(property)->get();
+  }
+  if (isTracking()) {
+    return const_cast<PropertyStore*>(this)->property(descriptor).get();
+  }
+  return descriptor.defaultValue();
+}
+
+template <typename T, typename Equal>
+Property<T, Equal>& PropertyStore::property(
+    const PropertyDescriptor<T, Equal>& descriptor) {
+  using PropertyType = Property<T, Equal>;
+  if (auto property = find(descriptor.id())) {
+    return *static_cast<PropertyType*>(property);
+  }
+  auto property = new PropertyType(descriptor.defaultValue());
+  property->setName(descriptor.name());
+  insert(descriptor.id(), property);
+  return *property;
+}
+
+template <typename T, typename Equal>
+void PropertyStore::clear(const PropertyDescriptor<T, Equal>& descriptor) {
+  using PropertyType = Property<T, Equal>;
+  auto property = static_cast<PropertyType*>(find(descriptor.id()));
+  if (!property) return;
+  if (isObserved(property)) {
+    property->unbind();
+    *property = descriptor.defaultValue();
+  } else {
+    erase(descriptor.id());
+  }
+}
+
+}  // namespace yuki
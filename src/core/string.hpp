@@ -1,11 +1,13 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include "core/typedef.h"
 
 namespace yuki {
 #ifdef UNICODE
 using Char = wchar_t;
 using String = std::wstring;
+using StringView = std::wstring_view;
 
 template <typename T>
 String ToString(T&& value) {
@@ -14,6 +16,7 @@ String ToString(T&& value) {
 #else
 using Char = char;
 using String = std::string;
+using StringView = std::string_view;
 
 template <typename T>
 String ToString(T&& value) {
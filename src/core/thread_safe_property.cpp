@@ -0,0 +1,107 @@
+#include "thread_safe_property.h"
+#include "core/dispatcher.h"
+#include <thread>
+#include <vector>
+
+namespace yuki {
+/*******************************************************************************
+ * class PropertyUpdateQueue
+ *
+ * Vyukov's intrusive MPSC queue. Producers only exchange |head| and link the
+ * previous head to the new node; the consumer walks from |tail|. A stub node
+ * keeps the list non-empty so that the last real node can be popped.
+ ******************************************************************************/
+class PropertyUpdateQueue {
+ public:
+  static void push(PropertyUpdate* node);
+  // Returns null if the queue is empty or a producer is halfway through a
+  // push; see empty() to tell the two apart.
+  static PropertyUpdate* pop();
+  static bool empty();
+
+ private:
+  class Stub : public PropertyUpdate {
+    void apply() override {}
+  };
+
+  static Stub stub;
+  static std::atomic<PropertyUpdate*> head;
+  static PropertyUpdate* tail;
+};
+
+PropertyUpdateQueue::Stub PropertyUpdateQueue::stub;
+std::atomic<PropertyUpdate*> PropertyUpdateQueue::head{&stub};
+PropertyUpdate* PropertyUpdateQueue::tail = &stub;
+
+void PropertyUpdateQueue::push(PropertyUpdate* node) {
+  node->next_.store(nullptr, std::memory_order_relaxed);
+  auto previous = head.exchange(node, std::memory_order_acq_rel);
+  previous->next_.store(node, std::memory_order_release);
+}
+
+PropertyUpdate* PropertyUpdateQueue::pop() {
+  auto node = tail;
+  auto next = node->next_.load(std::memory_order_acquire);
+  if (node == &stub) {
+    if (!next) return nullptr;
+    tail = next;
+    node = next;
+    next = next->next_.load(std::memory_order_acquire);
+  }
+  if (next) {
+    tail = next;
+    return node;
+  }
+  if (node != head.load(std::memory_order_acquire)) return nullptr;
+  push(&stub);
+  next = node->next_.load(std::memory_order_acquire);
+  if (next) {
+    tail = next;
+    return node;
+  }
+  return nullptr;
+}
+
+bool PropertyUpdateQueue::empty() {
+  return tail == &stub && !stub.next_.load(std::memory_order_acquire) &&
+         head.load(std::memory_order_acquire) == &stub;
+}
+
+/*******************************************************************************
+ * class PropertyUpdate
+ ******************************************************************************/
+void PropertyUpdate::applyPending() {
+  PropertyBatch batch;
+  while (auto update = PropertyUpdateQueue::pop()) {
+    update->apply();
+  }
+}
+
+bool PropertyUpdate::hasPending() { return !PropertyUpdateQueue::empty(); }
+
+void PropertyUpdate::enqueue() {
+  PropertyUpdateQueue::push(this);
+  // The main loop applies pending updates after every drain, so a wake is
+  // all it takes to get an idle loop to apply this one.
+  Dispatcher::main().signal();
+}
+
+void PropertyUpdate::cancel() {
+  // Take everything out and put the others back. A push still in flight
+  // blocks the walk for a moment, so wait for it rather than stop early.
+  std::vector<PropertyUpdate*> others;
+  for (;;) {
+    if (auto update = PropertyUpdateQueue::pop()) {
+      if (update != this) others.push_back(update);
+    } else if (PropertyUpdateQueue::empty()) {
+      break;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  for (auto update : others) {
+    PropertyUpdateQueue::push(update);
+  }
+}
+
+}  // namespace yuki
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include "core/property.h"
+
+namespace yuki {
+
+/*******************************************************************************
+ * class PropertyUpdate
+ *
+ * A node of the queue of properties that have a value posted from another
+ * thread. The queue is a lock-free intrusive multi-producer single-consumer
+ * list; the UI thread is its only consumer.
+ ******************************************************************************/
+class PropertyUpdate {
+ public:
+  PropertyUpdate() = default;
+  PropertyUpdate(const PropertyUpdate&) = delete;
+  PropertyUpdate& operator=(const PropertyUpdate&) = delete;
+  virtual ~PropertyUpdate() = default;
+
+  // Applies every posted value on the calling (UI) thread, in a single
+  // PropertyBatch. Call it once per frame, before layout and render.
+  static void applyPending();
+  static bool hasPending();
+
+ protected:
+  // Called by a producer that has just posted the first value since the
+  // last apply(). Signals Dispatcher::main().
+  void enqueue();
+  // Removes this update from the queue; only needed if it is still pending
+  // when its property is destroyed.
+  void cancel();
+  virtual void apply() = 0;
+
+ private:
+  std::atomic<PropertyUpdate*> next_{nullptr};
+  friend class PropertyUpdateQueue;
+};
+
+/*******************************************************************************
+ * class ThreadSafeProperty
+ *
+ * A Property that any thread may post() to. Posts are coalesced: only the
+ * latest value since the last PropertyUpdate::applyPending() is applied,
+ * so a high-frequency feed costs one propagation per frame. The first post
+ * since an apply wakes Dispatcher::main(), whose loop applies the pending
+ * values after each drain, even when it was idle. Reading, binding
+ * and direct assignment remain UI thread operations and are not synchronized.
+ * Producers must stop posting before the property is destroyed.
+ ******************************************************************************/
+template <typename T, typename Equal = PropertyEqual<T>>
+class ThreadSafeProperty : public Property<T, Equal>, private PropertyUpdate {
+ public:
+  using Property<T, Equal>::Property;
+  using Property<T, Equal>::operator=;
+  ~ThreadSafeProperty() {
+    if (auto value = pending_.exchange(nullptr)) {
+      cancel();
+      delete value;
+    }
+  }
+
+  // Thread-safe.
+  void post(T value) {
+    auto previous = pending_.exchange(new T(std::move(value)));
+    if (previous) {
+      delete previous;
+    } else {
+      enqueue();
+    }
+  }
+
+ private:
+  void apply() override {
+    if (auto value = pending_.exchange(nullptr)) {
+      Property<T, Equal>::operator=(std::move(*value));
+      delete value;
+    }
+  }
+
+  std::atomic<T*> pending_{nullptr};
+};
+
+}  // namespace yuki
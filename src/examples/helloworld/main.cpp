@@ -92,20 +92,20 @@ class MyView : public View {
 
   void sizeChangedEvent(SizeChangedEventArgs* args) override {
     const auto& size = args->getSize();
-    Logger::trace() << TEXT("sizeChangedEvent: ") << size.width() << TEXT(", ")
+    YUKI_LOG(Trace) << TEXT("sizeChangedEvent: ") << size.width() << TEXT(", ")
                     << size.height();
   }
 
   void sizeChangingEvent(SizeChangingEventArgs* args) override {
     const auto& rect = args->getRect();
-    Logger::trace() << TEXT("SizeChangingEventArgs: ") << rect.left()
+    YUKI_LOG(Trace) << TEXT("SizeChangingEventArgs: ") << rect.left()
                     << TEXT(", ") << rect.top() << TEXT(", ") << rect.right()
                     << TEXT(", ") << rect.bottom();
   }
 
   void mouseButtonUpEvent(MouseEventArgs* args) override {
     const auto& position = args->position();
-    Logger::trace() << TEXT("mouseButtonUpEvent: (") << position.x()
+    YUKI_LOG(Trace) << TEXT("mouseButtonUpEvent: (") << position.x()
                     << TEXT(", ") << position.y() << TEXT(") ")
                     << (args->isControlDown() ? TEXT("Ctrl ") : TEXT(""))
                     << (args->isShiftDown() ? TEXT("Shift ") : TEXT(""))
@@ -116,7 +116,7 @@ class MyView : public View {
 
   void mouseButtonDownEvent(MouseEventArgs* args) override {
     const auto& position = args->position();
-    Logger::trace() << TEXT("mouseButtonDownEvent: (") << position.x()
+    YUKI_LOG(Trace) << TEXT("mouseButtonDownEvent: (") << position.x()
                     << TEXT(", ") << position.y() << TEXT(") ")
                     << (args->isControlDown() ? TEXT("Ctrl ") : TEXT(""))
                     << (args->isShiftDown() ? TEXT("Shift ") : TEXT(""))
@@ -127,7 +127,7 @@ class MyView : public View {
 
   void mouseButtonDoubleClickEvent(MouseEventArgs* args) override {
     const auto& position = args->position();
-    Logger::trace() << TEXT("mouseButtonDoubleClickEvent: (") << position.x()
+    YUKI_LOG(Trace) << TEXT("mouseButtonDoubleClickEvent: (") << position.x()
                     << TEXT(", ") << position.y() << TEXT(") ")
                     << (args->isControlDown() ? TEXT("Ctrl ") : TEXT(""))
                     << (args->isShiftDown() ? TEXT("Shift ") : TEXT(""))
@@ -138,18 +138,20 @@ class MyView : public View {
 
   void mouseMoveEvent(MouseEventArgs* args) override {
     const auto& position = args->position();
-    Logger::trace() << TEXT("mouseMoveEvent: (") << position.x() << TEXT(", ")
-                    << position.y() << TEXT(") ")
-                    << (args->isControlDown() ? TEXT("Ctrl ") : TEXT(""))
-                    << (args->isShiftDown() ? TEXT("Shift ") : TEXT(""))
-                    << (args->isLButtonDown() ? TEXT("LButton ") : TEXT(""))
-                    << (args->isRButtonDown() ? TEXT("RButton ") : TEXT(""))
-                    << (args->isMButtonDown() ? TEXT("MButton") : TEXT(""));
+    // Moves come in bursts; keep them from drowning the other events.
+    YUKI_LOG_RATE_LIMITED(Trace, 20, 20)
+        << TEXT("mouseMoveEvent: (") << position.x() << TEXT(", ")
+        << position.y() << TEXT(") ")
+        << (args->isControlDown() ? TEXT("Ctrl ") : TEXT(""))
+        << (args->isShiftDown() ? TEXT("Shift ") : TEXT(""))
+        << (args->isLButtonDown() ? TEXT("LButton ") : TEXT(""))
+        << (args->isRButtonDown() ? TEXT("RButton ") : TEXT(""))
+        << (args->isMButtonDown() ? TEXT("MButton") : TEXT(""));
   }
 
   void mouseWheelEvent(MouseEventArgs* args) override {
     const auto& position = args->position();
-    Logger::trace() << TEXT("mouseWheelEvent: ") << TEXT("delta=")
+    YUKI_LOG(Trace) << TEXT("mouseWheelEvent: ") << TEXT("delta=")
                     << args->delta() << TEXT(" (") << position.x() << TEXT(", ")
                     << position.y() << TEXT(") ")
                     << (args->isControlDown() ? TEXT("Ctrl ") : TEXT(""))
@@ -160,16 +162,16 @@ class MyView : public View {
   }
 
   void keyDownEvent(KeyEventArgs* args) override {
-    Logger::trace() << TEXT("keyDownEvent: ")
+    YUKI_LOG(Trace) << TEXT("keyDownEvent: ")
                     << static_cast<int>(args->getKey());
   }
 
   void keyCharEvent(KeyCharEventArgs* args) override {
-    Logger::trace() << TEXT("keyCharEvent: ") << args->getChar();
+    YUKI_LOG(Trace) << TEXT("keyCharEvent: ") << args->getChar();
   }
 
   void keyUpEvent(KeyEventArgs* args) override {
-    Logger::trace() << TEXT("keyUpEvent: ") << static_cast<int>(args->getKey());
+    YUKI_LOG(Trace) << TEXT("keyUpEvent: ") << static_cast<int>(args->getKey());
   }
 
  private:
@@ -182,31 +184,31 @@ class TraceWindow : public Window {
   explicit TraceWindow(std::shared_ptr<View> view) : Window(std::move(view)) {}
 
   void activateEvent(ActivateEventArgs* args) override {
-    Logger::trace() << TEXT("activateEvent: ") << TEXT("isActivated=")
+    YUKI_LOG(Trace) << TEXT("activateEvent: ") << TEXT("isActivated=")
                     << args->isActivated();
   }
 
   void closingEvent(ClosingEventArgs* args) override {
-    Logger::trace() << TEXT("closingEvent");
+    YUKI_LOG(Trace) << TEXT("closingEvent");
   }
 
-  void closedEvent() override { Logger::trace() << TEXT("ClosedEvent"); }
+  void closedEvent() override { YUKI_LOG(Trace) << TEXT("ClosedEvent"); }
 
   void windowStateChangeEvent(WindowStateChangedEventArgs* args) override {
-    Logger::trace() << TEXT("windowStateChangeEvent: ") << TEXT("state=")
+    YUKI_LOG(Trace) << TEXT("windowStateChangeEvent: ") << TEXT("state=")
                     << static_cast<int>(args->state());
   }
 
   void movingEvent(WindowMovingEventArgs* args) override {
     const auto& rect = args->getRect();
-    Logger::trace() << TEXT("movingEvent: ") << rect.left() << TEXT(", ")
-                    << rect.top() << TEXT(", ") << rect.right() << TEXT(", ")
-                    << rect.bottom();
+    YUKI_LOG_RATE_LIMITED(Trace, 20, 20)
+        << TEXT("movingEvent: ") << rect.left() << TEXT(", ") << rect.top()
+        << TEXT(", ") << rect.right() << TEXT(", ") << rect.bottom();
   }
 
   void movedEvent(WindowMovedEventArgs* args) override {
     const auto& positon = args->getNewPosition();
-    Logger::trace() << TEXT("movedEvent: ") << positon.x() << TEXT(", ")
+    YUKI_LOG(Trace) << TEXT("movedEvent: ") << positon.x() << TEXT(", ")
                     << positon.y();
   }
 };
@@ -1,6 +1,8 @@
 #include "nativeapp.h"
 #include <Windows.h>
+#include "core/dispatcher.h"
 #include "core/logger.h"
+#include "core/thread_safe_property.h"
 #include "platforms/windows/direct2d.h"
 #include "platforms/windows/window_impl.h"
 
@@ -19,8 +21,9 @@ class Win32LoggerListener : public ILoggerListener {
   Win32LoggerListener& operator=(Win32LoggerListener&&) = default;
   virtual ~Win32LoggerListener() = default;
 
-  void write(const String& message) override {
-    ::OutputDebugString(std::wstring(message.cbegin(), message.cend()).c_str());
+  void write(StringView message) override {
+    // Records are null-terminated.
+    ::OutputDebugString(message.data());
   }
 };
 
@@ -28,15 +31,54 @@ class Win32LoggerListener : public ILoggerListener {
  * class NativeApp
  ******************************************************************************/
 
+const TCHAR NativeApp::DISPATCH_CLASS_NAME[] = TEXT("YUKI_DISPATCH_CLASS");
+HWND NativeApp::dispatchWindow = nullptr;
+
 void NativeApp::init() {
   Logger::addListener(std::make_shared<Win32LoggerListener>());
 
+  // Wake-ups go to a message-only window rather than to the thread: modal
+  // loops (window move and resize, menus, MessageBox) dispatch window
+  // messages but drop thread messages, which would leave the dispatcher
+  // signaled with nobody draining it.
+  WNDCLASSEX wcex = {};
+  wcex.cbSize = sizeof(WNDCLASSEX);
+  wcex.lpfnWndProc = DispatchProc;
+  wcex.hInstance = getInstance();
+  wcex.lpszClassName = DISPATCH_CLASS_NAME;
+  RegisterClassEx(&wcex);
+  dispatchWindow = ::CreateWindowEx(0, DISPATCH_CLASS_NAME, nullptr, 0, 0, 0,
+                                    0, 0, HWND_MESSAGE, nullptr,
+                                    getInstance(), nullptr);
+  auto window = dispatchWindow;
+  Dispatcher::main().setWakeHandler(
+      [window] { ::PostMessage(window, WM_DISPATCH, 0, 0); });
+  // Anything posted before init() signaled nobody.
+  ::PostMessage(window, WM_DISPATCH, 0, 0);
+
   NativeWindowManager::init();
   DirectXRes::init();
 }
 
 HINSTANCE NativeApp::getInstance() { return ::GetModuleHandle(nullptr); }
 
+// Runs on the UI thread from whichever loop is pumping messages, including
+// modal ones. A drain that leaves work behind posts another wake-up, so a
+// long queue does not starve native messages. Dispatcher::quit() ends the
+// message loop.
+LRESULT CALLBACK NativeApp::DispatchProc(HWND hWnd, UINT message,
+                                         WPARAM wParam, LPARAM lParam) {
+  if (message != WM_DISPATCH) {
+    return DefWindowProc(hWnd, message, wParam, lParam);
+  }
+  auto& dispatcher = Dispatcher::main();
+  dispatcher.drain();
+  PropertyUpdate::applyPending();
+  int exitCode;
+  if (dispatcher.takeQuit(exitCode)) ::PostQuitMessage(exitCode);
+  return 0;
+}
+
 inline int NativeApp::messageLoop() {
   MSG msg;
   BOOL result;
@@ -58,7 +100,12 @@ int NativeApp::run() {
   return result;
 }
 
-void NativeApp::terminate() { DirectXRes::releaseAll(); }
+void NativeApp::terminate() {
+  DirectXRes::releaseAll();
+  // Late wake-ups fail harmlessly once the window is gone.
+  ::DestroyWindow(dispatchWindow);
+  dispatchWindow = nullptr;
+}
 }  // namespace windows
 }  // namespace platforms
 }  // namespace yuki
\ No newline at end of file
@@ -13,6 +13,13 @@ class NativeApp {
 
  private:
   static void terminate();
+  static LRESULT CALLBACK DispatchProc(HWND hWnd, UINT message, WPARAM wParam,
+                                       LPARAM lParam);
+
+  static const TCHAR DISPATCH_CLASS_NAME[];
+  static constexpr UINT WM_DISPATCH = WM_APP + 1;
+  // A message-only window that receives the dispatcher wake-ups.
+  static HWND dispatchWindow;
 };
 }  // namespace windows
 }  // namespace platforms
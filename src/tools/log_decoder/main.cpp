@@ -0,0 +1,78 @@
+// Turns a binary log file, written by BinaryLoggerListener, back into text:
+//
+//   yuki_log_decoder trace.log > trace.txt
+//
+// Each line starts with the seconds since the first record.
+#include <core/binary_logger.h>
+#include <cstdint>
+#include <cstdio>
+
+using namespace yuki;
+
+namespace {
+// Writes |text| to stdout as UTF-8.
+void print(const String& text) {
+  if (sizeof(Char) == 1) {
+    std::fwrite(text.data(), 1, text.size(), stdout);
+    return;
+  }
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    auto c = static_cast<std::uint32_t>(text[i]);
+    if (sizeof(Char) == 2 && c >= 0xd800 && c < 0xdc00 &&
+        i + 1 < text.size()) {
+      // A UTF-16 surrogate pair.
+      c = 0x10000 + ((c - 0xd800) << 10) +
+          (static_cast<std::uint32_t>(text[++i]) - 0xdc00);
+    }
+    if (c < 0x80) {
+      std::putchar(static_cast<int>(c));
+    } else if (c < 0x800) {
+      std::putchar(static_cast<int>(0xc0 | (c >> 6)));
+      std::putchar(static_cast<int>(0x80 | (c & 0x3f)));
+    } else if (c < 0x10000) {
+      std::putchar(static_cast<int>(0xe0 | (c >> 12)));
+      std::putchar(static_cast<int>(0x80 | ((c >> 6) & 0x3f)));
+      std::putchar(static_cast<int>(0x80 | (c & 0x3f)));
+    } else {
+      std::putchar(static_cast<int>(0xf0 | (c >> 18)));
+      std::putchar(static_cast<int>(0x80 | ((c >> 12) & 0x3f)));
+      std::putchar(static_cast<int>(0x80 | ((c >> 6) & 0x3f)));
+      std::putchar(static_cast<int>(0x80 | (c & 0x3f)));
+    }
+  }
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s <log file>\n", argv[0]);
+    return 1;
+  }
+  auto file = std::fopen(argv[1], "rb");
+  if (!file) {
+    std::fprintf(stderr, "cannot open %s\n", argv[1]);
+    return 1;
+  }
+  BinaryLogReader reader(file);
+  if (!reader.isValid()) {
+    std::fprintf(stderr, "%s is not a binary log of this build\n", argv[1]);
+    std::fclose(file);
+    return 1;
+  }
+  std::uint64_t time;
+  std::uint64_t start = 0;
+  bool first = true;
+  String text;
+  while (reader.read(time, text)) {
+    if (first) {
+      start = time;
+      first = false;
+    }
+    // Text records are stamped when written, so they can be a little late.
+    auto elapsed = static_cast<std::int64_t>(time - start);
+    std::printf("%12.6f ", static_cast<double>(elapsed) * 1e-9);
+    print(text);
+  }
+  std::fclose(file);
+  return 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions of a benchmark executable to count
+// the calls. Include it from exactly one file of the executable. Every form
+// is replaced, so that no default deallocation function frees memory from a
+// replaced allocation function or the other way round.
+//
+// The counters are per thread: a benchmark reads those of the thread it
+// measures, and allocations of other threads, such as the logger writer, are
+// neither charged to it nor racing with it.
+
+namespace {
+thread_local std::size_t allocations = 0;
+thread_local std::size_t allocatedBytes = 0;
+
+void* countedAllocate(std::size_t size) {
+  ++allocations;
+  allocatedBytes += size;
+  if (auto p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+// Over-aligned blocks keep the pointer malloc() returned just before them.
+void* countedAllocate(std::size_t size, std::align_val_t alignment) {
+  auto align = static_cast<std::size_t>(alignment);
+  auto block = static_cast<char*>(countedAllocate(size + align + sizeof(void*)));
+  auto address = reinterpret_cast<std::uintptr_t>(block + sizeof(void*));
+  auto aligned = reinterpret_cast<char*>((address + align - 1) & ~(align - 1));
+  reinterpret_cast<void**>(aligned)[-1] = block;
+  return aligned;
+}
+
+void countedFree(void* p) noexcept { std::free(p); }
+
+void countedFree(void* p, std::align_val_t) noexcept {
+  if (p) std::free(static_cast<void**>(p)[-1]);
+}
+}  // namespace
+
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new[](std::size_t size) { return countedAllocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return countedAllocate(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return countedAllocate(size, alignment);
+}
+
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete(void* p, std::align_val_t alignment) noexcept {
+  countedFree(p, alignment);
+}
+void operator delete[](void* p, std::align_val_t alignment) noexcept {
+  countedFree(p, alignment);
+}
+void operator delete(void* p, std::size_t,
+                     std::align_val_t alignment) noexcept {
+  countedFree(p, alignment);
+}
+void operator delete[](void* p, std::size_t,
+                       std::align_val_t alignment) noexcept {
+  countedFree(p, alignment);
+}
@@ -0,0 +1,167 @@
+#include <core/binary_logger.h>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace yuki;
+
+class TextListener : public ILoggerListener {
+ public:
+  void write(StringView message) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    records_.emplace_back(message);
+  }
+
+  std::vector<String> records() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<String> records_;
+};
+
+int evaluations = 0;
+
+int evaluate() { return ++evaluations; }
+
+TEST(BinaryLogger, Text) {
+  auto listener = std::make_shared<TextListener>();
+  Logger::flush();
+  Logger::addListener(listener);
+  String name = TEXT("width");
+  YUKI_LOG_BINARY(Info, "move {} {} to ({}, {})", TEXT("view"), name, -3,
+                  0.5f);
+  YUKI_LOG_BINARY(Warning, "{} of {}", 42ull, 1.25, true);
+  YUKI_LOG_BINARY(Error, "no arguments");
+  Logger::flush();
+  Logger::removeListener(listener);
+
+  auto records = listener->records();
+  ASSERT_EQ(3u, records.size());
+  EXPECT_EQ(TEXT("|Info| move view width to (-3, 0.5)\n"), records[0]);
+  // Extra arguments are left out.
+  EXPECT_EQ(TEXT("|Warning| 42 of 1.25\n"), records[1]);
+  EXPECT_EQ(TEXT("|Error| no arguments\n"), records[2]);
+}
+
+TEST(BinaryLogger, Level) {
+  Logger::setLevel(LogLevel::Warning);
+  evaluations = 0;
+  YUKI_LOG_BINARY(Info, "{}", evaluate());
+  EXPECT_EQ(0, evaluations);
+  Logger::setLevel(LogLevel::Trace);
+  YUKI_LOG_BINARY(Info, "{}", evaluate());
+  EXPECT_EQ(1, evaluations);
+  Logger::flush();
+}
+
+TEST(BinaryLogger, File) {
+  auto path = testing::TempDir() + "binary_logger_unittest.log";
+  auto listener = std::make_shared<BinaryLoggerListener>(path.c_str());
+  ASSERT_TRUE(listener->isOpen());
+  Logger::flush();
+  Logger::addListener(listener);
+  for (int i = 0; i < 3; ++i) {
+    YUKI_LOG_BINARY(Trace, "mouseMoveEvent: ({}, {})", i, i * 0.5f);
+  }
+  Logger::debug() << TEXT("text ") << 7;
+  YUKI_LOG_BINARY(Info, "{}", String(300, TEXT('x')));
+  Logger::flush();
+  Logger::removeListener(listener);
+  listener.reset();
+
+  auto file = std::fopen(path.c_str(), "rb");
+  ASSERT_NE(nullptr, file);
+  BinaryLogReader reader(file);
+  EXPECT_TRUE(reader.isValid());
+  std::vector<String> records;
+  std::uint64_t time = 0;
+  String text;
+  while (reader.read(time, text)) {
+    EXPECT_GT(time, 0u);
+    records.push_back(text);
+  }
+  std::fclose(file);
+
+  ASSERT_EQ(5u, records.size());
+  EXPECT_EQ(TEXT("|Trace| mouseMoveEvent: (0, 0)\n"), records[0]);
+  EXPECT_EQ(TEXT("|Trace| mouseMoveEvent: (2, 1)\n"), records[2]);
+  EXPECT_EQ(TEXT("|DEBUG| text 7\n"), records[3]);
+  // Strings are truncated.
+  EXPECT_EQ(String(TEXT("|Info| ")) +
+                String(LogStringArgument::kMaxLength, TEXT('x')) + TEXT("\n"),
+            records[4]);
+  std::remove(path.c_str());
+}
+
+TEST(BinaryLogger, Truncated) {
+  auto path = testing::TempDir() + "binary_logger_unittest.log";
+  {
+    BinaryLoggerListener listener(path.c_str());
+    LogSite site(LogLevel::Info, "value {}", __FILE__, __LINE__, "i");
+    for (std::int32_t i = 0; i < 2; ++i) {
+      unsigned char arguments[sizeof(i)];
+      LogArgument<std::int32_t>::encode(arguments, i);
+      listener.write(LogRecord{&site, 0, arguments, sizeof(arguments)});
+    }
+  }
+  // The end of the last record is lost, as in a crash.
+  auto file = std::fopen(path.c_str(), "rb");
+  ASSERT_NE(nullptr, file);
+  std::vector<unsigned char> bytes;
+  for (int c; (c = std::fgetc(file)) != EOF;) {
+    bytes.push_back(static_cast<unsigned char>(c));
+  }
+  std::fclose(file);
+  file = std::fopen(path.c_str(), "wb");
+  std::fwrite(bytes.data(), bytes.size() - 2, 1, file);
+  std::fclose(file);
+
+  file = std::fopen(path.c_str(), "rb");
+  BinaryLogReader reader(file);
+  std::uint64_t time;
+  String text;
+  ASSERT_TRUE(reader.read(time, text));
+  EXPECT_EQ(TEXT("|Info| value 0\n"), text);
+  EXPECT_FALSE(reader.read(time, text));
+  std::fclose(file);
+  std::remove(path.c_str());
+}
+
+TEST(BinaryLogger, BadLevel) {
+  auto path = testing::TempDir() + "binary_logger_unittest.log";
+  { BinaryLoggerListener listener(path.c_str()); }
+  // A definition with a level past Fatal, then a record of its site.
+  auto file = std::fopen(path.c_str(), "ab");
+  ASSERT_NE(nullptr, file);
+  const char strings[] = "i\0value {}\0file";
+  const std::uint16_t definition[] = {BinaryLoggerListener::kDefinition,
+                                      8 + sizeof(strings), 1, 42, 1, 0};
+  std::fwrite(definition, sizeof(definition), 1, file);
+  std::fwrite(strings, sizeof(strings), 1, file);
+  const std::uint16_t record[] = {1, 12};
+  const std::uint64_t time = 1;
+  const std::int32_t value = 7;
+  std::fwrite(record, sizeof(record), 1, file);
+  std::fwrite(&time, sizeof(time), 1, file);
+  std::fwrite(&value, sizeof(value), 1, file);
+  std::fclose(file);
+
+  file = std::fopen(path.c_str(), "rb");
+  BinaryLogReader reader(file);
+  EXPECT_TRUE(reader.isValid());
+  std::uint64_t readTime;
+  String text;
+  EXPECT_FALSE(reader.read(readTime, text));
+  std::fclose(file);
+  std::remove(path.c_str());
+}
+
+}  // namespace
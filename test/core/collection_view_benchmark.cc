@@ -0,0 +1,110 @@
+#include <core/collection_view.h>
+#include <core/observable_vector.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+using namespace yuki;
+using Clock = std::chrono::steady_clock;
+
+template <typename F>
+double measure(int iterations, F&& f) {
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    f(i);
+  }
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+  return elapsed.count();
+}
+
+void report(const char* name, double view, double rebuild) {
+  std::printf("%-32s %10.3f ms view %10.3f ms rebuild %8.1fx\n", name,
+              view * 1e3, rebuild * 1e3, rebuild / view);
+}
+
+std::mt19937 random(42);
+
+std::vector<int> values(int count) {
+  std::vector<int> result(count);
+  for (auto& value : result) {
+    value = static_cast<int>(random());
+  }
+  return result;
+}
+
+bool isEven(int value) { return value % 2 == 0; }
+
+// What the views replace: sorting or filtering a copy of the source.
+std::vector<int> sorted(const ObservableVector<int>& source) {
+  auto result = source.values();
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+std::vector<int> filtered(const ObservableVector<int>& source) {
+  std::vector<int> result;
+  std::copy_if(source.begin(), source.end(), std::back_inserter(result),
+               isEven);
+  return result;
+}
+
+// Builds a view over |count| rows, appends |appended| rows in one batch and
+// then replaces single rows |ticks| times, against rebuilding after each.
+template <typename MakeView, typename Rebuild>
+void compare(const char* name, int count, int appended, int ticks,
+             MakeView makeView, Rebuild rebuild) {
+  ObservableVector<int> source(values(count));
+  std::size_t check = 0;
+  char label[64];
+
+  decltype(makeView(source)) view;
+  auto built = measure(1, [&](int) { view = makeView(source); });
+  auto rebuilt = measure(1, [&](int) { check += rebuild(source).size(); });
+  std::snprintf(label, sizeof(label), "%s: build %d", name, count);
+  report(label, built, rebuilt);
+
+  auto rows = values(appended);
+  auto appendedView = measure(1, [&](int) {
+    source.batch([&] { source.append(rows.begin(), rows.end()); });
+  });
+  rebuilt = measure(1, [&](int) { check += rebuild(source).size(); });
+  std::snprintf(label, sizeof(label), "%s: append %d", name, appended);
+  report(label, appendedView, rebuilt);
+
+  auto size = static_cast<int>(source.size());
+  auto ticked = measure(ticks, [&](int) {
+    source.set(random() % size, static_cast<int>(random()));
+  });
+  constexpr int kRebuilds = 10;
+  rebuilt = measure(kRebuilds, [&](int) { check += rebuild(source).size(); });
+  std::snprintf(label, sizeof(label), "%s: set 1 row", name);
+  report(label, ticked / ticks, rebuilt / kRebuilds);
+
+  if (check == 42 || view->size() == 42) std::printf("\n");
+}
+
+}  // namespace
+
+int main() {
+  compare(
+      "sorted", 100000, 5000, 1000,
+      [](ObservableVector<int>& source) {
+        return std::make_unique<SortedView<ObservableVector<int>>>(source);
+      },
+      sorted);
+  compare(
+      "filtered", 100000, 5000, 1000,
+      [](ObservableVector<int>& source) {
+        return std::make_unique<
+            FilteredView<ObservableVector<int>, bool (*)(int)>>(source,
+                                                                 isEven);
+      },
+      filtered);
+  return 0;
+}
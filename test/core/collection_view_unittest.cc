@@ -0,0 +1,310 @@
+#include <core/collection_view.h>
+#include <core/observable_vector.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace yuki;
+
+template <typename View>
+std::vector<typename View::value_type> toVector(const View& view) {
+  std::vector<typename View::value_type> result;
+  for (std::size_t i = 0; i < view.size(); ++i) {
+    result.push_back(view[i]);
+  }
+  return result;
+}
+
+bool isEven(int value) { return value % 2 == 0; }
+
+TEST(CollectionView, Mapped) {
+  ObservableVector<int> source = {1, 2, 3};
+  MappedView mapped(source, [](int value) { return std::to_string(value); });
+  EXPECT_EQ(std::vector<std::string>({"1", "2", "3"}), toVector(mapped));
+
+  std::vector<CollectionChange> changes;
+  mapped.collectionChanged().addHandler(
+      [&changes](Object*, CollectionChangedEventArgs* args) {
+        changes = args->changes();
+      });
+  source.batch([&source] {
+    source.push_back(4);
+    source.set(0, 5);
+    source.move(1, 1, 0);
+  });
+  EXPECT_EQ(std::vector<std::string>({"2", "5", "3", "4"}), toVector(mapped));
+  EXPECT_EQ(std::vector<CollectionChange>({{CollectionChange::kInsert, 3, 1},
+                                           {CollectionChange::kReplace, 0, 1},
+                                           {CollectionChange::kMove, 1, 1, 0}}),
+            changes);
+}
+
+TEST(CollectionView, Filtered) {
+  ObservableVector<int> source = {1, 2, 3, 4};
+  FilteredView filtered(source, isEven);
+  EXPECT_EQ(std::vector<int>({2, 4}), toVector(filtered));
+
+  std::vector<std::vector<CollectionChange>> notifications;
+  filtered.collectionChanged().addHandler(
+      [&notifications](Object*, CollectionChangedEventArgs* args) {
+        notifications.push_back(args->changes());
+      });
+  source.push_back(5);
+  EXPECT_TRUE(notifications.empty());
+  source.push_back(6);
+  ASSERT_EQ(1u, notifications.size());
+  EXPECT_EQ(std::vector<CollectionChange>(
+                {{CollectionChange::kInsert, 2, 1}}),
+            notifications.back());
+
+  // 1 2 3 4 5 6 -> 1 8 3 4 5 6: replaced and still passing.
+  source.set(1, 8);
+  EXPECT_EQ(std::vector<CollectionChange>(
+                {{CollectionChange::kReplace, 0, 1}}),
+            notifications.back());
+  // -> 1 8 3 7 5 6: stops passing.
+  source.set(3, 7);
+  EXPECT_EQ(std::vector<CollectionChange>(
+                {{CollectionChange::kErase, 1, 1}}),
+            notifications.back());
+  // -> 1 8 3 7 10 6: starts passing.
+  source.set(4, 10);
+  EXPECT_EQ(std::vector<CollectionChange>(
+                {{CollectionChange::kInsert, 1, 1}}),
+            notifications.back());
+  EXPECT_EQ(std::vector<int>({8, 10, 6}), toVector(filtered));
+  EXPECT_EQ(4u, filtered.sourceIndex(1));
+
+  source.move(4, 2, 0);
+  EXPECT_EQ(std::vector<int>({10, 6, 8}), toVector(filtered));
+  EXPECT_EQ(std::vector<CollectionChange>(
+                {{CollectionChange::kMove, 1, 2, 0}}),
+            notifications.back());
+  // 10 6 1 8 3 7 -> 10 6 1 8 7
+  notifications.clear();
+  source.erase(4);
+  EXPECT_TRUE(notifications.empty());
+  EXPECT_EQ(std::vector<int>({10, 6, 8}), toVector(filtered));
+}
+
+TEST(CollectionView, FilteredAppendsInOneNotification) {
+  ObservableVector<int> source;
+  FilteredView filtered(source, isEven);
+  std::vector<std::vector<CollectionChange>> notifications;
+  filtered.collectionChanged().addHandler(
+      [&notifications](Object*, CollectionChangedEventArgs* args) {
+        notifications.push_back(args->changes());
+      });
+  source.batch([&source] {
+    for (int i = 0; i < 1000; ++i) {
+      source.push_back(i * 2);
+    }
+  });
+  ASSERT_EQ(1u, notifications.size());
+  EXPECT_EQ(std::vector<CollectionChange>(
+                {{CollectionChange::kInsert, 0, 1000}}),
+            notifications.back());
+}
+
+TEST(CollectionView, Sorted) {
+  struct Row {
+    int key = 0;
+    int id = 0;
+  };
+  ObservableVector<Row> source = {{3, 0}, {1, 1}, {2, 2}, {1, 3}};
+  auto byKey = [](const Row& a, const Row& b) { return a.key < b.key; };
+  SortedView sorted(source, byKey);
+  auto ids = [&sorted] {
+    std::vector<int> result;
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+      result.push_back(sorted[i].id);
+    }
+    return result;
+  };
+  // Equivalent rows keep their arrival order.
+  EXPECT_EQ(std::vector<int>({1, 3, 2, 0}), ids());
+
+  std::vector<CollectionChange> changes;
+  sorted.collectionChanged().addHandler(
+      [&changes](Object*, CollectionChangedEventArgs* args) {
+        changes = args->changes();
+      });
+  source.push_back({2, 4});
+  EXPECT_EQ(std::vector<int>({1, 3, 2, 4, 0}), ids());
+  EXPECT_EQ(std::vector<CollectionChange>({{CollectionChange::kInsert, 3, 1}}),
+            changes);
+
+  source.set(0, {0, 0});
+  EXPECT_EQ(std::vector<int>({0, 1, 3, 2, 4}), ids());
+  EXPECT_EQ(std::vector<CollectionChange>(
+                {{CollectionChange::kMove, 4, 1, 0},
+                 {CollectionChange::kReplace, 0, 1}}),
+            changes);
+
+  changes.clear();
+  source.move(0, 2, 3);
+  EXPECT_TRUE(changes.empty());
+  source.erase(1);
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 4}), ids());
+  EXPECT_EQ(std::vector<CollectionChange>({{CollectionChange::kErase, 2, 1}}),
+            changes);
+}
+
+TEST(CollectionView, Aggregate) {
+  ObservableVector<int> source = {4, 2, 7};
+  SumView sum(source);
+  CountView evens(source, isEven);
+  MinView minimum(source);
+  MaxView maximum(source);
+  Property<int> range;
+  range.bind([&minimum, &maximum] { return maximum.get() - minimum.get(); },
+             minimum.value(), maximum.value());
+  EXPECT_EQ(13, sum.get());
+  EXPECT_EQ(2u, evens.get());
+  EXPECT_EQ(5, range.get());
+
+  source.batch([&source] {
+    source.push_back(10);
+    source.set(1, 1);
+    source.erase(0);
+  });
+  EXPECT_EQ(18, sum.get());
+  EXPECT_EQ(1u, evens.get());
+  EXPECT_EQ(1, minimum.get());
+  EXPECT_EQ(10, maximum.get());
+  EXPECT_EQ(9, range.get());
+
+  source.clear();
+  EXPECT_EQ(0, sum.get());
+  EXPECT_EQ(0u, evens.get());
+  EXPECT_EQ(0, range.get());
+}
+
+TEST(CollectionView, AggregateUnordered) {
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  ObservableVector<double> source = {1.0, nan, 3.0, 4.0, 5.0};
+  MinView minimum(source);
+  // NaN breaks the ordering of the extremum set, so a removed value may not
+  // be found in it any more.
+  source.erase(0);
+  source.erase(2);
+  source.erase(0);
+  source.erase(0);
+  source.push_back(2.0);
+  EXPECT_EQ(2u, source.size());
+}
+
+TEST(CollectionView, Stacked) {
+  ObservableVector<int> source;
+  FilteredView evens(source, isEven);
+  MappedView halves(evens, [](int value) { return value / 2; });
+  SortedView sorted(halves, std::greater<int>());
+  SumView sum(sorted);
+  source.batch([&source] {
+    for (int i = 0; i < 10; ++i) {
+      source.push_back(i);
+    }
+  });
+  EXPECT_EQ(std::vector<int>({4, 3, 2, 1, 0}), toVector(sorted));
+  EXPECT_EQ(10, sum.get());
+  source.set(3, 20);
+  source.erase(8);
+  EXPECT_EQ(std::vector<int>({10, 3, 2, 1, 0}), toVector(sorted));
+  EXPECT_EQ(16, sum.get());
+}
+
+TEST(CollectionView, RandomEdits) {
+  // Every view must match the one rebuilt from scratch after each batch.
+  std::mt19937 random(42);
+  auto next = [&random](int bound) {
+    return std::uniform_int_distribution<int>(0, bound - 1)(random);
+  };
+  ObservableVector<int> source;
+  FilteredView filtered(source, isEven);
+  MappedView mapped(source, [](int value) { return value * 3; });
+  SortedView sorted(source);
+  SumView sum(source);
+  MinView minimum(source);
+  // Stacked views only see the deltas of the views below them.
+  SortedView sortedEvens(filtered);
+  FilteredView evensSorted(sorted, isEven);
+  MappedView mappedSorted(sorted, [](int value) { return value * 3; });
+  SortedView sortedMapped(mapped);
+
+  for (int round = 0; round < 500; ++round) {
+    // Every fourth batch is large enough to be merged in one pass.
+    source.batch([&] {
+      for (int edits = next(round % 4 ? 8 : 64); edits >= 0; --edits) {
+        auto size = static_cast<int>(source.size());
+        switch (next(size ? 6 : 1)) {
+          case 0:
+            source.insert(next(size + 1), next(100));
+            break;
+          case 1:
+            source.erase(next(size));
+            break;
+          case 2:
+            source.set(next(size), next(100));
+            break;
+          case 3: {
+            int count = 1 + next(size);
+            source.move(next(size - count + 1), count,
+                        next(size - count + 1));
+            break;
+          }
+          case 4: {
+            int index = next(size);
+            source.erase(index, 1 + next(size - index));
+            break;
+          }
+          case 5: {
+            std::vector<int> values(1 + next(32));
+            for (auto& value : values) {
+              value = next(100);
+            }
+            source.insert(next(size + 1), values.begin(), values.end());
+            break;
+          }
+        }
+      }
+    });
+
+    const auto& values = source.values();
+    std::vector<int> expected;
+    std::copy_if(values.begin(), values.end(), std::back_inserter(expected),
+                 isEven);
+    ASSERT_EQ(expected, toVector(filtered)) << round;
+    expected.clear();
+    for (auto value : values) {
+      expected.push_back(value * 3);
+    }
+    ASSERT_EQ(expected, toVector(mapped)) << round;
+    expected = values;
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(expected, toVector(sorted)) << round;
+    std::vector<int> evens;
+    std::copy_if(expected.begin(), expected.end(), std::back_inserter(evens),
+                 isEven);
+    ASSERT_EQ(evens, toVector(sortedEvens)) << round;
+    ASSERT_EQ(evens, toVector(evensSorted)) << round;
+    for (auto& value : expected) {
+      value *= 3;
+    }
+    ASSERT_EQ(expected, toVector(mappedSorted)) << round;
+    ASSERT_EQ(expected, toVector(sortedMapped)) << round;
+    int total = 0;
+    for (auto value : values) {
+      total += value;
+    }
+    ASSERT_EQ(total, sum.get()) << round;
+    ASSERT_EQ(values.empty() ? 0 : expected.front() / 3, minimum.get())
+        << round;
+  }
+}
+
+}  // namespace
@@ -0,0 +1,152 @@
+#include <core/dispatcher.h>
+#include <core/thread_safe_property.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace yuki;
+
+TEST(Dispatcher, Priorities) {
+  Dispatcher dispatcher;
+  std::vector<int> calls;
+  auto record = [&calls](int value) {
+    return [&calls, value] { calls.push_back(value); };
+  };
+  dispatcher.post(record(30), DispatchPriority::Idle);
+  dispatcher.post(record(20), DispatchPriority::Background);
+  dispatcher.post(record(10), DispatchPriority::Render);
+  dispatcher.post(record(21), DispatchPriority::Background);
+  dispatcher.post(record(0), DispatchPriority::Input);
+  dispatcher.post(record(11), DispatchPriority::Render);
+  EXPECT_FALSE(dispatcher.empty());
+  EXPECT_FALSE(dispatcher.drain());
+  EXPECT_EQ(std::vector<int>({0, 10, 11, 20, 21, 30}), calls);
+  EXPECT_TRUE(dispatcher.empty());
+}
+
+TEST(Dispatcher, Preemption) {
+  Dispatcher dispatcher;
+  std::vector<int> calls;
+  dispatcher.post([&] {
+    calls.push_back(1);
+    dispatcher.post([&calls] { calls.push_back(3); },
+                    DispatchPriority::Input);
+  });
+  dispatcher.post([&calls] { calls.push_back(4); });
+  dispatcher.post([&calls] { calls.push_back(5); }, DispatchPriority::Idle);
+  dispatcher.drain();
+  // The input posted by the first task runs before the queued background
+  // task.
+  EXPECT_EQ(std::vector<int>({1, 3, 4, 5}), calls);
+}
+
+TEST(Dispatcher, Batches) {
+  Dispatcher dispatcher;
+  int wakes = 0;
+  int calls = 0;
+  dispatcher.setWakeHandler([&wakes] { ++wakes; });
+  for (int i = 0; i < 25; ++i) {
+    dispatcher.post([&calls] { ++calls; });
+  }
+  // Only the first post finds the dispatcher idle.
+  EXPECT_EQ(1, wakes);
+  EXPECT_TRUE(dispatcher.drain(10));
+  EXPECT_EQ(10, calls);
+  // Work is left, so the loop is woken again.
+  EXPECT_EQ(2, wakes);
+  EXPECT_TRUE(dispatcher.drain(10));
+  EXPECT_FALSE(dispatcher.drain(10));
+  EXPECT_EQ(25, calls);
+  EXPECT_EQ(3, wakes);
+
+  dispatcher.post([&calls] { ++calls; });
+  EXPECT_EQ(4, wakes);
+}
+
+TEST(Dispatcher, FireEvent) {
+  Dispatcher dispatcher;
+  Event<void(int, const std::string&)> event;
+  std::string received;
+  event.addHandler([&received](int count, const std::string& text) {
+    for (int i = 0; i < count; ++i) received += text;
+  });
+  {
+    std::string text = "ab";
+    dispatcher.fire(DispatchPriority::Input, event, 2, text);
+  }
+  EXPECT_TRUE(received.empty());
+  dispatcher.drain();
+  EXPECT_EQ("abab", received);
+}
+
+TEST(Dispatcher, Discard) {
+  auto counter = std::make_shared<int>(0);
+  {
+    Dispatcher dispatcher;
+    dispatcher.post([counter] { ++*counter; });
+    EXPECT_EQ(2, counter.use_count());
+  }
+  EXPECT_EQ(1, counter.use_count());
+  EXPECT_EQ(0, *counter);
+}
+
+TEST(Dispatcher, HeadlessLoop) {
+  constexpr int kThreads = 4;
+  constexpr int kPosts = 10000;
+  Dispatcher dispatcher;
+  // The last task run for each thread and priority; render tasks have even
+  // numbers and background tasks odd ones.
+  std::vector<int> last;
+  for (int t = 0; t < kThreads; ++t) {
+    last.push_back(-2);
+    last.push_back(-1);
+  }
+  int total = 0;
+  bool ordered = true;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&dispatcher, &last, &total, &ordered, t] {
+      for (int i = 0; i < kPosts; ++i) {
+        auto priority =
+            i % 2 ? DispatchPriority::Background : DispatchPriority::Render;
+        dispatcher.post(
+            [&dispatcher, &last, &total, &ordered, t, i] {
+              // Posts from one thread at one priority keep their order.
+              auto& previous = last[t * 2 + i % 2];
+              ordered = ordered && previous == i - 2;
+              previous = i;
+              if (++total == kThreads * kPosts) dispatcher.quit(7);
+            },
+            priority);
+      }
+    });
+  }
+  EXPECT_EQ(7, dispatcher.run());
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(kThreads * kPosts, total);
+  EXPECT_TRUE(ordered);
+  EXPECT_TRUE(dispatcher.empty());
+}
+
+TEST(Dispatcher, PropertyUpdatesStayOnMain) {
+  ThreadSafeProperty<int> value = 0;
+  value.post(1);
+  // Another dispatcher may run on any thread, so it must not apply updates
+  // meant for the UI thread.
+  Dispatcher dispatcher;
+  dispatcher.post([&dispatcher] { dispatcher.quit(); });
+  EXPECT_EQ(0, dispatcher.run());
+  EXPECT_TRUE(PropertyUpdate::hasPending());
+  EXPECT_EQ(0, value.get());
+  PropertyUpdate::applyPending();
+  EXPECT_EQ(1, value.get());
+}
+
+}  // namespace
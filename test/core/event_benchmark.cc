@@ -0,0 +1,145 @@
+#include <core/event.h>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <vector>
+#include "allocation_counter.h"
+
+namespace {
+
+using namespace yuki;
+using Clock = std::chrono::steady_clock;
+
+template <typename F>
+double measure(int iterations, F&& f) {
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    f(i);
+  }
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+  return elapsed.count();
+}
+
+void fire(int handlers, int iterations) {
+  Event<void(int)> event;
+  std::vector<EventConnection> connections;
+  long long sum = 0;
+  for (int i = 0; i < handlers; ++i) {
+    connections.push_back(
+        event.addHandler([&sum, i](int value) { sum += value + i; }));
+  }
+  auto allocationsBefore = allocations;
+  auto seconds = measure(iterations, [&event](int i) { event.fire(i); });
+  char name[32];
+  std::snprintf(name, sizeof(name), "fire (%d handlers)", handlers);
+  std::printf("%-24s %10.1f ns/fire %10.2f ns/handler %6.2f allocations\n",
+              name, seconds * 1e9 / iterations,
+              seconds * 1e9 / iterations / handlers,
+              static_cast<double>(allocations - allocationsBefore) /
+                  iterations);
+  if (sum == 42) std::printf("\n");
+}
+
+struct Listener {
+  void onValue(int value) { sum += value; }
+  long long sum = 0;
+};
+
+// Bound to its lifetime when connected.
+struct TrackedListener : Object {
+  void onValue(int value) { sum += value; }
+  long long sum = 0;
+};
+
+void fireMember(int handlers, int iterations) {
+  Event<void(int)> event;
+  std::vector<Listener> listeners(handlers);
+  std::vector<EventConnection> connections;
+  for (auto& listener : listeners) {
+    connections.push_back(event.addHandler(&listener, &Listener::onValue));
+  }
+  auto seconds = measure(iterations, [&event](int i) { event.fire(i); });
+  char name[32];
+  std::snprintf(name, sizeof(name), "fire (%d members)", handlers);
+  std::printf("%-24s %10.1f ns/fire %10.2f ns/handler\n", name,
+              seconds * 1e9 / iterations,
+              seconds * 1e9 / iterations / handlers);
+}
+
+void fireTracked(int handlers, int iterations) {
+  Event<void(int)> event;
+  std::vector<TrackedListener> listeners(handlers);
+  for (auto& listener : listeners) {
+    event.addHandler(&listener, &TrackedListener::onValue);
+  }
+  auto seconds = measure(iterations, [&event](int i) { event.fire(i); });
+  char name[32];
+  std::snprintf(name, sizeof(name), "fire (%d tracked)", handlers);
+  std::printf("%-24s %10.1f ns/fire %10.2f ns/handler\n", name,
+              seconds * 1e9 / iterations,
+              seconds * 1e9 / iterations / handlers);
+}
+
+// Allocations made by connecting |count| lambdas that capture three
+// pointers, against a plain vector of std::function.
+void connect(int count) {
+  int a = 0;
+  int b = 0;
+  int c = 0;
+  auto handler = [&a, &b, &c](int value) { a += value + b + c; };
+
+  auto allocationsBefore = allocations;
+  {
+    std::vector<std::function<void(int)>> handlers;
+    for (int i = 0; i < count; ++i) {
+      handlers.push_back(handler);
+    }
+  }
+  std::printf("%-24s %10.3f allocations/handler\n", "std::function",
+              static_cast<double>(allocations - allocationsBefore) / count);
+
+  allocationsBefore = allocations;
+  {
+    Event<void(int)> event;
+    for (int i = 0; i < count; ++i) {
+      event.addHandler(handler);
+    }
+  }
+  std::printf("%-24s %10.3f allocations/handler\n", "Event::addHandler",
+              static_cast<double>(allocations - allocationsBefore) / count);
+}
+
+// Every fire removes one handler and adds another, both from inside the
+// dispatch.
+void churn(int handlers, int iterations) {
+  Event<void()> event;
+  std::vector<EventConnection> connections(handlers);
+  int next = 0;
+  for (int i = 0; i < handlers; ++i) {
+    connections[i] = event.addHandler([] {});
+  }
+  event.addHandler([&] {
+    connections[next].disconnect();
+    connections[next] = event.addHandler([] {});
+    next = (next + 1) % handlers;
+  });
+  auto seconds = measure(iterations, [&event](int) { event.fire(); });
+  char name[32];
+  std::snprintf(name, sizeof(name), "churn (%d handlers)", handlers);
+  std::printf("%-24s %10.1f ns/fire\n", name, seconds * 1e9 / iterations);
+}
+
+}  // namespace
+
+int main() {
+  fire(1, 10000000);
+  fire(10, 1000000);
+  fire(1000, 10000);
+  fireMember(1, 10000000);
+  fireMember(10, 1000000);
+  fireTracked(10, 1000000);
+  connect(1000);
+  churn(10, 1000000);
+  churn(1000, 10000);
+  return 0;
+}
@@ -0,0 +1,288 @@
+#include <core/event.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace {
+
+using namespace yuki;
+
+TEST(Event, AddAndRemove) {
+  Event<void(int)> event;
+  std::vector<int> calls;
+  auto a = event.addHandler([&calls](int value) { calls.push_back(value); });
+  auto b = event.addHandler([&calls](int value) { calls.push_back(-value); });
+  event.fire(1);
+  std::sort(calls.begin(), calls.end());
+  EXPECT_EQ(std::vector<int>({-1, 1}), calls);
+  EXPECT_EQ(2u, event.size());
+
+  calls.clear();
+  EXPECT_TRUE(a.connected());
+  event.removeHandler(a);
+  EXPECT_FALSE(a.connected());
+  event.fire(2);
+  EXPECT_EQ(std::vector<int>({-2}), calls);
+
+  calls.clear();
+  b.disconnect();
+  b.disconnect();
+  event.fire(3);
+  EXPECT_TRUE(calls.empty());
+  EXPECT_TRUE(event.empty());
+}
+
+TEST(Event, StaleConnection) {
+  Event<void()> event;
+  int first = 0;
+  int second = 0;
+  auto a = event.addHandler([&first] { ++first; });
+  auto stale = a;
+  a.disconnect();
+  // Reuses the slot of the first handler.
+  auto b = event.addHandler([&second] { ++second; });
+  EXPECT_FALSE(stale.connected());
+  stale.disconnect();
+  event.fire();
+  EXPECT_EQ(0, first);
+  EXPECT_EQ(1, second);
+  EXPECT_TRUE(b.connected());
+}
+
+TEST(Event, RemoveFromMiddle) {
+  Event<void(int)> event;
+  std::vector<int> calls;
+  std::vector<EventConnection> connections;
+  for (int i = 0; i < 100; ++i) {
+    connections.push_back(
+        event.addHandler([&calls, i](int) { calls.push_back(i); }));
+  }
+  for (int i = 0; i < 100; i += 3) {
+    connections[i].disconnect();
+  }
+  event.fire(0);
+  std::sort(calls.begin(), calls.end());
+  std::vector<int> expected;
+  for (int i = 0; i < 100; ++i) {
+    if (i % 3) expected.push_back(i);
+  }
+  EXPECT_EQ(expected, calls);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i % 3 != 0, connections[i].connected());
+  }
+}
+
+TEST(Event, ScopedConnection) {
+  Event<void()> event;
+  int calls = 0;
+  {
+    ScopedEventConnection connection =
+        event.addHandler([&calls] { ++calls; });
+    event.fire();
+    ScopedEventConnection moved = std::move(connection);
+    event.fire();
+  }
+  event.fire();
+  EXPECT_EQ(2, calls);
+
+  EventConnection kept;
+  {
+    ScopedEventConnection connection =
+        event.addHandler([&calls] { ++calls; });
+    kept = connection.release();
+  }
+  event.fire();
+  EXPECT_EQ(3, calls);
+  EXPECT_TRUE(kept.connected());
+}
+
+TEST(Event, ConnectionOutlivesEvent) {
+  EventConnection connection;
+  ScopedEventConnection scoped;
+  {
+    Event<void()> event;
+    connection = event.addHandler([] {});
+    scoped = event.addHandler([] {});
+  }
+  EXPECT_FALSE(connection.connected());
+  connection.disconnect();
+}
+
+TEST(Event, RemoveDuringFire) {
+  Event<void()> event;
+  std::vector<int> calls;
+  std::vector<EventConnection> connections(4);
+  for (int i = 0; i < 4; ++i) {
+    connections[i] = event.addHandler([&calls, &connections, i] {
+      calls.push_back(i);
+      // Each handler removes itself and the handler after it.
+      connections[i].disconnect();
+      connections[(i + 1) % 4].disconnect();
+    });
+  }
+  event.fire();
+  EXPECT_EQ(std::vector<int>({0, 2}), calls);
+  EXPECT_TRUE(event.empty());
+
+  calls.clear();
+  event.fire();
+  EXPECT_TRUE(calls.empty());
+}
+
+TEST(Event, AddDuringFire) {
+  Event<void()> event;
+  int added = 0;
+  std::vector<EventConnection> connections;
+  event.addHandler([&event, &added, &connections] {
+    connections.push_back(event.addHandler([&added] { ++added; }));
+  });
+  event.fire();
+  // Handlers added by a fire are first called by the next one.
+  EXPECT_EQ(0, added);
+  EXPECT_EQ(2u, event.size());
+  event.fire();
+  EXPECT_EQ(1, added);
+  EXPECT_EQ(3u, event.size());
+
+  // Removing a handler added during the same fire.
+  Event<void()> other;
+  other.addHandler([&other, &added] {
+    auto connection = other.addHandler([&added] { ++added; });
+    EXPECT_TRUE(connection.connected());
+    connection.disconnect();
+    EXPECT_FALSE(connection.connected());
+  });
+  other.fire();
+  other.fire();
+  EXPECT_EQ(1, added);
+  EXPECT_EQ(1u, other.size());
+}
+
+TEST(Event, NestedFire) {
+  Event<void(int)> event;
+  std::vector<int> calls;
+  EventConnection removed;
+  EventConnection added;
+  event.addHandler([&](int depth) {
+    calls.push_back(depth * 10);
+    if (depth < 2) {
+      event.fire(depth + 1);
+    }
+    if (depth == 1) {
+      removed.disconnect();
+      added = event.addHandler(
+          [&calls](int depth) { calls.push_back(depth * 10 + 2); });
+    }
+  });
+  removed = event.addHandler(
+      [&calls](int depth) { calls.push_back(depth * 10 + 1); });
+
+  event.fire(0);
+  // Only depth 2 reaches the second handler before depth 1 removes it, and
+  // no depth sees the handler added at depth 1.
+  EXPECT_EQ(std::vector<int>({0, 10, 20, 21}), calls);
+  EXPECT_FALSE(removed.connected());
+  EXPECT_TRUE(added.connected());
+  EXPECT_EQ(2u, event.size());
+
+  calls.clear();
+  added.disconnect();
+  event.fire(2);
+  EXPECT_EQ(std::vector<int>({20}), calls);
+}
+
+TEST(Event, ThrowingHandler) {
+  Event<void()> event;
+  int calls = 0;
+  EventConnection connection;
+  event.addHandler([&connection] {
+    connection.disconnect();
+    throw 1;
+  });
+  connection = event.addHandler([&calls] { ++calls; });
+  EXPECT_THROW(event.fire(), int);
+  EXPECT_EQ(1u, event.size());
+  // The tombstone was compacted despite the exception.
+  auto other = event.addHandler([&calls] { ++calls; });
+  EXPECT_EQ(2u, event.size());
+  other.disconnect();
+  EXPECT_EQ(0, calls);
+}
+
+TEST(Event, MemberHandler) {
+  struct Listener {
+    void onValue(int value) { total += value; }
+    int total = 0;
+  };
+  Listener listener;
+  Event<void(int)> event;
+  auto connection = event.addHandler(&listener, &Listener::onValue);
+  event.fire(2);
+  event.fire(3);
+  connection.disconnect();
+  event.fire(4);
+  EXPECT_EQ(5, listener.total);
+}
+
+class Listener : public Object {
+ public:
+  explicit Listener(int* total) : total_(total) {}
+  void onValue(int value) { *total_ += value; }
+
+ private:
+  int* total_;
+};
+
+TEST(Event, OwnerLifetime) {
+  Event<void(int)> event;
+  int total = 0;
+  auto listener = std::make_unique<Listener>(&total);
+  auto member = event.addHandler(listener.get(), &Listener::onValue);
+  auto lambda =
+      event.addHandler(listener.get(), [&total](int value) { total += value; });
+  event.addHandler([&total](int) { total += 100; });
+  event.fire(1);
+  EXPECT_EQ(102, total);
+  EXPECT_EQ(3u, event.size());
+
+  listener.reset();
+  EXPECT_FALSE(member.connected());
+  EXPECT_FALSE(lambda.connected());
+  event.fire(1);
+  EXPECT_EQ(202, total);
+  // Purged by the fire.
+  EXPECT_EQ(1u, event.size());
+  member.disconnect();
+}
+
+TEST(Event, OwnerDestroyedDuringFire) {
+  Event<void()> event;
+  int total = 0;
+  auto listener = std::make_unique<Listener>(&total);
+  event.addHandler([&listener] { listener.reset(); });
+  event.addHandler(listener.get(), [&total] { ++total; });
+  event.fire();
+  EXPECT_EQ(0, total);
+  EXPECT_EQ(1u, event.size());
+}
+
+TEST(Event, OwnerOutlivesEvent) {
+  int total = 0;
+  Listener listener(&total);
+  {
+    Event<void(int)> event;
+    event.addHandler(&listener, &Listener::onValue);
+    event.fire(1);
+  }
+  // A copy has a lifetime of its own.
+  Event<void(int)> event;
+  auto copy = std::make_unique<Listener>(listener);
+  event.addHandler(&listener, &Listener::onValue);
+  copy.reset();
+  event.fire(1);
+  EXPECT_EQ(2, total);
+  EXPECT_EQ(1u, event.size());
+}
+
+}  // namespace
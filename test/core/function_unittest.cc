@@ -0,0 +1,117 @@
+#include <core/function.h>
+#include <gtest/gtest.h>
+#include <array>
+#include <memory>
+#include <string>
+
+namespace {
+
+using namespace yuki;
+
+TEST(InlineFunction, Empty) {
+  InlineFunction<int()> f;
+  EXPECT_FALSE(f);
+  f = [] { return 1; };
+  EXPECT_TRUE(f);
+  f = nullptr;
+  EXPECT_FALSE(f);
+}
+
+TEST(InlineFunction, InlineStorage) {
+  int a = 1;
+  int b = 2;
+  int c = 3;
+  auto sum = [&a, &b, &c] { return a + b + c; };
+  EXPECT_TRUE(InlineFunction<int()>::isInline<decltype(sum)>());
+
+  InlineFunction<int()> f = sum;
+  EXPECT_EQ(6, f());
+  c = 10;
+  EXPECT_EQ(13, f());
+}
+
+TEST(InlineFunction, HeapFallback) {
+  std::array<int, 16> values{};
+  values[15] = 7;
+  auto last = [values] { return values[15]; };
+  EXPECT_FALSE(InlineFunction<int()>::isInline<decltype(last)>());
+
+  InlineFunction<int()> f = last;
+  InlineFunction<int()> g = f;
+  InlineFunction<int()> h = std::move(f);
+  EXPECT_FALSE(f);
+  EXPECT_EQ(7, g());
+  EXPECT_EQ(7, h());
+}
+
+TEST(InlineFunction, CopyAndMove) {
+  auto counter = std::make_shared<int>(0);
+  InlineFunction<void(int)> f = [counter](int n) { *counter += n; };
+  EXPECT_EQ(2, counter.use_count());
+  {
+    auto g = f;
+    EXPECT_EQ(3, counter.use_count());
+    g(2);
+  }
+  EXPECT_EQ(2, counter.use_count());
+
+  InlineFunction<void(int)> h;
+  h = std::move(f);
+  h(3);
+  EXPECT_EQ(5, *counter);
+  EXPECT_EQ(2, counter.use_count());
+  h = nullptr;
+  EXPECT_EQ(1, counter.use_count());
+}
+
+TEST(InlineFunction, Arguments) {
+  InlineFunction<std::string(const std::string&, std::unique_ptr<int>)> f =
+      [](const std::string& s, std::unique_ptr<int> p) {
+        return s + std::to_string(*p);
+      };
+  EXPECT_EQ("x1", f("x", std::make_unique<int>(1)));
+}
+
+TEST(InlineFunction, MemberFunction) {
+  struct Counter {
+    int add(int n) { return total += n; }
+    int get() const { return total; }
+    int total = 0;
+  };
+  Counter counter;
+  InlineFunction<int(int)> add(&counter, &Counter::add);
+  InlineFunction<void(int)> discard(&counter, &Counter::add);
+  InlineFunction<int()> get(&counter, &Counter::get);
+  EXPECT_EQ(2, add(2));
+  discard(3);
+  EXPECT_EQ(5, get());
+
+  auto copy = add;
+  EXPECT_EQ(6, copy(1));
+  EXPECT_EQ(6, counter.total);
+}
+
+TEST(InlineFunction, TrivialCopy) {
+  int a = 1;
+  auto plus = [&a](int n) { return a + n; };
+  EXPECT_TRUE(InlineFunction<int(int)>::isTrivial<decltype(plus)>());
+  auto counter = std::make_shared<int>(0);
+  auto shared = [counter](int n) { return *counter + n; };
+  EXPECT_FALSE(InlineFunction<int(int)>::isTrivial<decltype(shared)>());
+
+  InlineFunction<int(int)> f = plus;
+  auto g = f;
+  InlineFunction<int(int)> h;
+  h = std::move(f);
+  EXPECT_FALSE(f);
+  a = 10;
+  EXPECT_EQ(12, g(2));
+  EXPECT_EQ(13, h(3));
+  g = shared;
+  EXPECT_EQ(3, counter.use_count());
+  g = h;
+  EXPECT_EQ(2, counter.use_count());
+  EXPECT_EQ(14, g(4));
+}
+
+}  // namespace
@@ -0,0 +1,150 @@
+#include <core/binary_logger.h>
+#include <core/logger.h>
+#include <core/mapped_file_logger.h>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include <vector>
+#include "allocation_counter.h"
+
+namespace {
+
+using namespace yuki;
+using Clock = std::chrono::steady_clock;
+
+// Counts the bytes a log file would take: text as is, binary records as
+// entries of BinaryLoggerListener.
+class NullListener : public ILoggerListener {
+ public:
+  void write(StringView message) override {
+    bytes += message.size() * sizeof(Char);
+  }
+  void write(const LogRecord& record) override {
+    bytes += 2 * sizeof(std::uint16_t) + sizeof(record.time) + record.size;
+  }
+
+  std::size_t bytes = 0;
+};
+
+std::shared_ptr<NullListener> listener = std::make_shared<NullListener>();
+
+template <typename F>
+double measure(int iterations, F&& f) {
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    f(i);
+  }
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+  return elapsed.count();
+}
+
+// The cost on the logging thread, in batches that fit in its buffer so that
+// the writer keeps up.
+template <typename F>
+void record(const char* name, int iterations, F&& f) {
+  Logger::flush();
+  auto bytes = listener->bytes;
+  constexpr int kBatch = 200;
+  double seconds = 0;
+  std::size_t allocated = 0;
+  auto dropped = Logger::dropped();
+  for (int done = 0; done < iterations; done += kBatch) {
+    auto allocationsBefore = allocations;
+    seconds += measure(kBatch, f);
+    allocated += allocations - allocationsBefore;
+    Logger::flush();
+  }
+  std::printf(
+      "%-24s %10.1f ns/record %6.2f allocations %6.1f bytes/record %llu "
+      "dropped\n",
+      name, seconds * 1e9 / iterations,
+      static_cast<double>(allocated) / iterations,
+      static_cast<double>(listener->bytes - bytes) / iterations,
+      static_cast<unsigned long long>(Logger::dropped() - dropped));
+}
+
+void threads(int count, int iterations) {
+  std::vector<std::thread> threads;
+  auto start = Clock::now();
+  for (int t = 0; t < count; ++t) {
+    threads.emplace_back([iterations] {
+      for (int i = 0; i < iterations; ++i) {
+        Logger::trace() << TEXT("worker ") << i;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+  Logger::flush();
+  char name[32];
+  std::snprintf(name, sizeof(name), "%d threads (block)", count);
+  std::printf("%-24s %10.1f ns/record\n", name,
+              elapsed.count() * 1e9 / iterations);
+}
+
+// The cost of a file listener on the writer thread, flushed every batch,
+// against stdio.
+void sinks(int iterations) {
+  constexpr int kBatch = 200;
+  auto directory =
+      std::filesystem::temp_directory_path() / "yuki_logger_benchmark";
+  String line = TEXT("|Trace| mouseMoveEvent: (123, 61.5)\n");
+  {
+    MappedFileLoggerListener sink(directory / "sink.log", 1 << 20);
+    auto seconds = measure(iterations, [&sink, &line](int i) {
+      sink.write(line);
+      if (i % kBatch == 0) sink.flush();
+    });
+    std::printf("%-24s %10.1f ns/record\n", "mapped file",
+                seconds * 1e9 / iterations);
+  }
+  auto path = directory / "sink.txt";
+  if (auto file = std::fopen(path.string().c_str(), "wb")) {
+    auto seconds = measure(iterations, [file, &line](int i) {
+      std::fwrite(line.data(), sizeof(Char), line.size(), file);
+      if (i % kBatch == 0) std::fflush(file);
+    });
+    std::fclose(file);
+    std::printf("%-24s %10.1f ns/record\n", "stdio file",
+                seconds * 1e9 / iterations);
+  }
+  std::error_code error;
+  std::filesystem::remove_all(directory, error);
+}
+
+}  // namespace
+
+int main() {
+  Logger::addListener(listener);
+  record("record (text)", 100000,
+         [](int) { Logger::trace() << TEXT("mouseMoveEvent"); });
+  Logger::setLevel(LogLevel::Error);
+  record("filtered (runtime)", 10000000, [](int i) {
+    YUKI_LOG(Warning) << TEXT("mouseMoveEvent: (") << i << TEXT(", ")
+                    << i * 0.5f << TEXT(")");
+  });
+  Logger::setLevel(LogLevel::Trace);
+  record("record (formatted)", 100000, [](int i) {
+    Logger::trace() << TEXT("mouseMoveEvent: (") << i << TEXT(", ")
+                    << i * 0.5f << TEXT(")");
+  });
+  record("sampled (1 in 100)", 10000000, [](int i) {
+    YUKI_LOG_EVERY_N(Info, 100) << TEXT("mouseMoveEvent: (") << i
+                                << TEXT(", ") << i * 0.5f << TEXT(")");
+  });
+  record("rate limited (100/s)", 10000000, [](int i) {
+    YUKI_LOG_RATE_LIMITED(Info, 100, 10) << TEXT("mouseMoveEvent: (") << i
+                                         << TEXT(", ") << i * 0.5f
+                                         << TEXT(")");
+  });
+  record("binary (formatted)", 100000, [](int i) {
+    YUKI_LOG_BINARY(Info, "mouseMoveEvent: ({}, {})", i, i * 0.5f);
+  });
+  Logger::setOverflow(LoggerOverflow::Block);
+  threads(4, 100000);
+  sinks(1000000);
+  return 0;
+}
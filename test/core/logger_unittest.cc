@@ -0,0 +1,348 @@
+#include <core/logger.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace yuki;
+
+class RecordingListener : public ILoggerListener {
+ public:
+  void write(StringView message) override {
+    ++writes_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (blocked_) {
+      std::this_thread::yield();
+    }
+    records_.emplace_back(message);
+  }
+  void flush() override { ++flushes_; }
+
+  std::vector<String> records() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_;
+  }
+  int flushes() const { return flushes_; }
+  // Calls to write(), counted before it blocks.
+  int writes() const { return writes_; }
+  void block(bool blocked) { blocked_ = blocked; }
+
+ private:
+  std::mutex mutex_;
+  std::vector<String> records_;
+  std::atomic<int> flushes_{0};
+  std::atomic<int> writes_{0};
+  std::atomic<bool> blocked_{false};
+};
+
+class LoggerTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    Logger::flush();
+    Logger::addListener(listener_);
+  }
+  void TearDown() override {
+    listener_->block(false);
+    Logger::flush();
+    Logger::removeListener(listener_);
+    Logger::setOverflow(LoggerOverflow::Drop);
+  }
+
+  std::shared_ptr<RecordingListener> listener_ =
+      std::make_shared<RecordingListener>();
+};
+
+TEST_F(LoggerTest, Record) {
+  Logger::info() << TEXT("value ") << 42 << TEXT(' ') << 1.5;
+  Logger::flush();
+  auto records = listener_->records();
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ(TEXT("|Info| value 42 1.5\n"), records[0]);
+  EXPECT_GE(listener_->flushes(), 1);
+}
+
+int nested() {
+  Logger::debug() << TEXT("inner ") << -7;
+  return 3;
+}
+
+TEST_F(LoggerTest, NestedRecord) {
+  // The inner record is written while the outer one is being built.
+  Logger::info() << TEXT("outer ") << nested() << TEXT(" ") << 0.25f;
+  Logger::flush();
+  auto records = listener_->records();
+  ASSERT_EQ(2u, records.size());
+  EXPECT_EQ(TEXT("|DEBUG| inner -7\n"), records[0]);
+  EXPECT_EQ(TEXT("|Info| outer 3 0.25\n"), records[1]);
+}
+
+TEST_F(LoggerTest, Truncation) {
+  String line(Logger::kMaxLength * 2, TEXT('x'));
+  Logger::info() << line << 42;
+  Logger::flush();
+  auto records = listener_->records();
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ(Logger::kMaxLength, records[0].size());
+  EXPECT_EQ(0u, records[0].find(TEXT("|Info| xxx")));
+  EXPECT_EQ(TEXT("xx\n"), records[0].substr(records[0].size() - 3));
+}
+
+TEST_F(LoggerTest, Threads) {
+  constexpr int kThreads = 4;
+  constexpr int kRecords = 2000;
+  Logger::setOverflow(LoggerOverflow::Block);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([t] {
+      for (int i = 0; i < kRecords; ++i) {
+        Logger::trace() << t << TEXT(" ") << i;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  Logger::flush();
+
+  // Every record arrives whole, and in order for each thread.
+  auto records = listener_->records();
+  ASSERT_EQ(static_cast<std::size_t>(kThreads * kRecords), records.size());
+  std::vector<int> next(kThreads, 0);
+  for (auto& record : records) {
+    int t = record[8] - TEXT('0');
+    ASSERT_EQ(String(TEXT("|Trace| ")) + ToString(t) + TEXT(" ") +
+                  ToString(next[t]) + TEXT("\n"),
+              record);
+    ++next[t];
+  }
+}
+
+TEST_F(LoggerTest, Overflow) {
+  // Fill the buffer of this thread while the writer is stuck in a listener.
+  Logger::info() << TEXT("first");
+  listener_->block(true);
+  String line(1000, TEXT('x'));
+  auto dropped = Logger::dropped();
+  Logger::setOverflow(LoggerOverflow::Drop);
+  for (int i = 0; i < 1000; ++i) {
+    Logger::info() << line;
+  }
+  EXPECT_GT(Logger::dropped(), dropped);
+
+  dropped = Logger::dropped();
+  Logger::setOverflow(LoggerOverflow::Count);
+  for (int i = 0; i < 1000; ++i) {
+    Logger::info() << line;
+  }
+  auto counted = Logger::dropped() - dropped;
+  EXPECT_GT(counted, 0u);
+  listener_->block(false);
+  Logger::flush();
+  // Reported by the next record of the thread, where the records were lost.
+  Logger::info() << TEXT("last");
+  Logger::flush();
+  // A notice is short enough to fit where a record did not, so the count
+  // may be split between several.
+  auto records = listener_->records();
+  String warning = TEXT("|Warning| ");
+  std::uint64_t reported = 0;
+  for (auto& record : records) {
+    if (record.compare(0, warning.size(), warning) == 0) {
+      reported += std::stoull(record.substr(warning.size()));
+    }
+  }
+  EXPECT_EQ(counted, reported);
+  EXPECT_EQ(0u, records[records.size() - 2].find(warning));
+  EXPECT_EQ(TEXT("|Info| last\n"), records.back());
+
+  // Blocking loses nothing.
+  listener_->block(true);
+  Logger::setOverflow(LoggerOverflow::Block);
+  std::thread unblock([this] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    listener_->block(false);
+  });
+  dropped = Logger::dropped();
+  auto before = listener_->records().size();
+  for (int i = 0; i < 1000; ++i) {
+    Logger::info() << line;
+  }
+  unblock.join();
+  Logger::flush();
+  EXPECT_EQ(dropped, Logger::dropped());
+  EXPECT_EQ(before + 1000, listener_->records().size());
+}
+
+int evaluations = 0;
+
+int evaluate() { return ++evaluations; }
+
+TEST_F(LoggerTest, Level) {
+  Logger::setLevel(LogLevel::Warning);
+  evaluations = 0;
+  YUKI_LOG(Info) << evaluate();
+  YUKI_LOG(Warning) << evaluate();
+  // The factories filter the record, but evaluate the operands.
+  Logger::info() << evaluate();
+  Logger::error() << evaluate();
+  Logger::setLevel(LogLevel::Trace);
+  YUKI_LOG(Trace) << evaluate();
+  Logger::flush();
+  EXPECT_EQ(4, evaluations);
+  auto records = listener_->records();
+  ASSERT_EQ(3u, records.size());
+  EXPECT_EQ(TEXT("|Warning| 1\n"), records[0]);
+  EXPECT_EQ(TEXT("|Error| 3\n"), records[1]);
+  EXPECT_EQ(TEXT("|Trace| 4\n"), records[2]);
+
+  // A dangling else binds to the caller's if.
+  bool logged = false;
+  if (logged)
+    YUKI_LOG(Info) << evaluate();
+  else
+    logged = true;
+  EXPECT_TRUE(logged);
+}
+
+TEST_F(LoggerTest, EveryN) {
+  evaluations = 0;
+  for (int i = 0; i < 10; ++i) {
+    YUKI_LOG_EVERY_N(Info, 4) << i << TEXT(" ") << evaluate();
+  }
+  Logger::flush();
+  EXPECT_EQ(3, evaluations);
+  auto records = listener_->records();
+  ASSERT_EQ(3u, records.size());
+  EXPECT_EQ(TEXT("|Info| 0 1\n"), records[0]);
+  EXPECT_EQ(TEXT("|Info| (3 suppressed) 4 2\n"), records[1]);
+  EXPECT_EQ(TEXT("|Info| (3 suppressed) 8 3\n"), records[2]);
+}
+
+void logLimited(int i) {
+  // A burst of two, then one every 50 ms.
+  YUKI_LOG_RATE_LIMITED(Warning, 20, 2) << i << TEXT(" ") << evaluate();
+}
+
+TEST_F(LoggerTest, RateLimited) {
+  evaluations = 0;
+  for (int i = 0; i < 100; ++i) {
+    logLimited(i);
+  }
+  // Each site has its own budget.
+  YUKI_LOG_RATE_LIMITED(Warning, 20, 2) << TEXT("other");
+  Logger::flush();
+  // Refilled as time passes.
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  logLimited(100);
+  Logger::flush();
+
+  // Allowing for a clock tick during the burst.
+  EXPECT_GE(evaluations, 3);
+  EXPECT_LE(evaluations, 4);
+  auto records = listener_->records();
+  ASSERT_EQ(static_cast<std::size_t>(evaluations + 1), records.size());
+  EXPECT_EQ(TEXT("|Warning| 0 1\n"), records[0]);
+  EXPECT_EQ(TEXT("|Warning| 1 2\n"), records[1]);
+  EXPECT_EQ(TEXT("|Warning| other\n"), records[records.size() - 2]);
+  auto suppressed = String(TEXT("(")) + ToString(100 - (evaluations - 1)) +
+                    TEXT(" suppressed) 100 ");
+  EXPECT_EQ(String(TEXT("|Warning| ")) + suppressed + ToString(evaluations) +
+                TEXT("\n"),
+            records.back());
+}
+
+TEST_F(LoggerTest, RateLimitedHighRate) {
+  // Far more than one record per pass of the writer thread.
+  evaluations = 0;
+  auto start = std::chrono::steady_clock::now();
+  auto end = start + std::chrono::milliseconds(200);
+  while (std::chrono::steady_clock::now() < end) {
+    YUKI_LOG_RATE_LIMITED(Info, 1000, 1) << evaluate();
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  Logger::flush();
+  // One record per millisecond, less whatever a descheduled thread missed.
+  EXPECT_LE(evaluations, elapsed.count() + 1);
+  EXPECT_GE(evaluations, 100);
+  EXPECT_EQ(static_cast<std::size_t>(evaluations),
+            listener_->records().size());
+}
+
+TEST_F(LoggerTest, ChangeListeners) {
+  // The writer is stuck in a listener, and the listeners change anyway.
+  listener_->block(true);
+  Logger::info() << TEXT("first");
+  while (!listener_->writes()) {
+    std::this_thread::yield();
+  }
+  auto other = std::make_shared<RecordingListener>();
+  Logger::addListener(other);
+  Logger::removeListener(listener_);
+  Logger::info() << TEXT("second");
+  listener_->block(false);
+  Logger::flush();
+  Logger::removeListener(other);
+  Logger::info() << TEXT("third");
+  Logger::flush();
+
+  auto records = listener_->records();
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ(TEXT("|Info| first\n"), records[0]);
+  records = other->records();
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ(TEXT("|Info| second\n"), records[0]);
+}
+
+TEST_F(LoggerTest, ChangeListenersWhileLogging) {
+  constexpr int kRecords = 20000;
+  Logger::setOverflow(LoggerOverflow::Block);
+  std::atomic<bool> done{false};
+  std::thread thread([&done] {
+    for (int i = 0; i < kRecords; ++i) {
+      Logger::trace() << i;
+    }
+    done = true;
+  });
+  int changes = 0;
+  while (!done) {
+    auto listener = std::make_shared<RecordingListener>();
+    Logger::addListener(listener);
+    std::this_thread::yield();
+    Logger::removeListener(listener);
+    ++changes;
+  }
+  thread.join();
+  Logger::flush();
+  EXPECT_GT(changes, 0);
+
+  // The listener that stayed got everything.
+  auto records = listener_->records();
+  ASSERT_EQ(static_cast<std::size_t>(kRecords), records.size());
+  EXPECT_EQ(TEXT("|Trace| 0\n"), records.front());
+  EXPECT_EQ(String(TEXT("|Trace| ")) + ToString(kRecords - 1) + TEXT("\n"),
+            records.back());
+}
+
+// Levels below YUKI_LOG_MIN_LEVEL are compiled out, whatever the runtime
+// level; the macro reads the minimum where it is expanded.
+#undef YUKI_LOG_MIN_LEVEL
+#define YUKI_LOG_MIN_LEVEL 3
+
+TEST_F(LoggerTest, MinimumLevel) {
+  evaluations = 0;
+  YUKI_LOG(Trace) << evaluate();
+  YUKI_LOG(Info) << evaluate();
+  YUKI_LOG(Warning) << evaluate();
+  Logger::flush();
+  EXPECT_EQ(1, evaluations);
+  auto records = listener_->records();
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ(TEXT("|Warning| 1\n"), records[0]);
+}
+
+}  // namespace
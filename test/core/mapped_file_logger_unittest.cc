@@ -0,0 +1,160 @@
+#include <core/mapped_file_logger.h>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+using namespace yuki;
+namespace fs = std::filesystem;
+
+class MappedFileLoggerTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    std::error_code error;
+    fs::remove_all(directory_, error);
+  }
+  void TearDown() override {
+    std::error_code error;
+    fs::remove_all(directory_, error);
+  }
+
+  fs::path segment(int sequence) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "app.%06d.log", sequence);
+    return directory_ / name;
+  }
+
+  // The bytes of a file.
+  static std::vector<unsigned char> read(const fs::path& path) {
+    std::vector<unsigned char> bytes;
+    if (auto file = std::fopen(path.string().c_str(), "rb")) {
+      for (int c; (c = std::fgetc(file)) != EOF;) {
+        bytes.push_back(static_cast<unsigned char>(c));
+      }
+      std::fclose(file);
+    }
+    return bytes;
+  }
+
+  // The text of a segment, after its byte order mark.
+  static String text(const fs::path& path) {
+    auto bytes = read(path);
+    String text(bytes.size() / sizeof(Char), Char());
+    if (!text.empty()) std::memcpy(&text[0], bytes.data(), bytes.size());
+    if (sizeof(Char) > 1) {
+      EXPECT_FALSE(text.empty());
+      if (!text.empty()) {
+        EXPECT_EQ(static_cast<Char>(0xfeff), text[0]);
+        text.erase(0, 1);
+      }
+    }
+    return text;
+  }
+
+  static void write(const fs::path& path, const String& text,
+                    std::size_t size) {
+    std::vector<unsigned char> bytes(size);
+    std::memcpy(bytes.data(), text.data(), text.size() * sizeof(Char));
+    auto file = std::fopen(path.string().c_str(), "wb");
+    ASSERT_NE(nullptr, file);
+    std::fwrite(bytes.data(), bytes.size(), 1, file);
+    std::fclose(file);
+  }
+
+  fs::path directory_ =
+      fs::path(testing::TempDir()) / "mapped_file_logger_unittest";
+};
+
+TEST_F(MappedFileLoggerTest, Logger) {
+  auto listener =
+      std::make_shared<MappedFileLoggerListener>(directory_ / "app.log");
+  ASSERT_TRUE(listener->isOpen());
+  EXPECT_EQ(segment(1), listener->segmentPath());
+  Logger::flush();
+  Logger::addListener(listener);
+  Logger::info() << TEXT("first ") << 1;
+  Logger::warning() << TEXT("second");
+  Logger::flush();
+  Logger::removeListener(listener);
+  // The segment keeps its full size until it is closed.
+  EXPECT_EQ(MappedFileLoggerListener::kSegmentSize, fs::file_size(segment(1)));
+  listener.reset();
+  EXPECT_EQ(TEXT("|Info| first 1\n|Warning| second\n"), text(segment(1)));
+}
+
+TEST_F(MappedFileLoggerTest, Rotation) {
+  String line(15, TEXT('x'));
+  line += TEXT('\n');
+  {
+    // Room for the byte order mark and three lines.
+    MappedFileLoggerListener listener(directory_ / "app.log",
+                                      (1 + 3 * 16) * sizeof(Char), 2);
+    for (int i = 0; i < 10; ++i) {
+      listener.write(line);
+    }
+    EXPECT_EQ(segment(4), listener.segmentPath());
+  }
+  // Only the newest two segments are left.
+  EXPECT_FALSE(fs::exists(segment(1)));
+  EXPECT_FALSE(fs::exists(segment(2)));
+  EXPECT_EQ(line + line + line, text(segment(3)));
+  EXPECT_EQ(line, text(segment(4)));
+
+  // A new listener carries on from the last segment.
+  MappedFileLoggerListener listener(directory_ / "app.log", 4096, 2);
+  EXPECT_EQ(segment(5), listener.segmentPath());
+  EXPECT_FALSE(fs::exists(segment(3)));
+}
+
+TEST_F(MappedFileLoggerTest, Recovery) {
+  // A segment left at full size by a crash, in the middle of a record.
+  fs::create_directories(directory_);
+  String written;
+  if (sizeof(Char) > 1) written += static_cast<Char>(0xfeff);
+  written += TEXT("|Info| kept\n|Info| cut sh");
+  write(segment(7), written, 1024 * sizeof(Char));
+  // A segment closed cleanly is left alone.
+  String clean = TEXT("no newline");
+  write(segment(6), clean, clean.size() * sizeof(Char));
+
+  MappedFileLoggerListener listener(directory_ / "app.log", 4096);
+  EXPECT_EQ(segment(8), listener.segmentPath());
+  EXPECT_EQ(TEXT("|Info| kept\n"), text(segment(7)));
+  EXPECT_EQ(clean.size() * sizeof(Char), fs::file_size(segment(6)));
+  EXPECT_FALSE(MappedFileLoggerListener::recover(segment(7)));
+}
+
+#ifndef _WIN32
+TEST_F(MappedFileLoggerTest, AllocationFailure) {
+  // A file size limit makes the allocation fail as a full disk would.
+  std::signal(SIGXFSZ, SIG_IGN);
+  rlimit limit;
+  ASSERT_EQ(0, ::getrlimit(RLIMIT_FSIZE, &limit));
+  auto small = limit;
+  small.rlim_cur = 4096;
+  ASSERT_EQ(0, ::setrlimit(RLIMIT_FSIZE, &small));
+  MappedFileLoggerListener listener(directory_ / "app.log", 1 << 20);
+  ::setrlimit(RLIMIT_FSIZE, &limit);
+  std::signal(SIGXFSZ, SIG_DFL);
+  EXPECT_FALSE(listener.isOpen());
+  // The segment that could not be allocated is not left behind.
+  EXPECT_FALSE(fs::exists(segment(1)));
+
+  std::this_thread::sleep_for(MappedFileLoggerListener::kRetryInterval);
+  listener.flush();
+  ASSERT_TRUE(listener.isOpen());
+  EXPECT_EQ(segment(1), listener.segmentPath());
+}
+#endif
+
+}  // namespace
@@ -0,0 +1,188 @@
+#include <core/observable_vector.h>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+using namespace yuki;
+using Change = CollectionChange;
+
+class ObservableVectorTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    vector.collectionChanged().addHandler(
+        [this](Object* sender, CollectionChangedEventArgs* args) {
+          EXPECT_EQ(&vector, sender);
+          notifications.push_back(args->changes());
+        });
+  }
+
+  std::vector<Change> last() const {
+    return notifications.empty() ? std::vector<Change>()
+                                 : notifications.back();
+  }
+
+  ObservableVector<int> vector;
+  std::vector<std::vector<Change>> notifications;
+};
+
+TEST_F(ObservableVectorTest, Edits) {
+  vector.push_back(1);
+  EXPECT_EQ(std::vector<Change>({{Change::kInsert, 0, 1}}), last());
+  int values[] = {2, 3, 4, 5};
+  vector.append(std::begin(values), std::end(values));
+  EXPECT_EQ(std::vector<Change>({{Change::kInsert, 1, 4}}), last());
+  vector.erase(1, 2);
+  EXPECT_EQ(std::vector<Change>({{Change::kErase, 1, 2}}), last());
+  vector.set(0, 6);
+  EXPECT_EQ(std::vector<Change>({{Change::kReplace, 0, 1}}), last());
+  EXPECT_EQ(std::vector<int>({6, 4, 5}), vector.values());
+  vector.move(0, 1, 2);
+  EXPECT_EQ(std::vector<Change>({{Change::kMove, 0, 1, 2}}), last());
+  EXPECT_EQ(std::vector<int>({4, 5, 6}), vector.values());
+  vector.move(1, 2, 0);
+  EXPECT_EQ(std::vector<int>({5, 6, 4}), vector.values());
+  EXPECT_EQ(6u, notifications.size());
+
+  vector.erase(0, 0);
+  vector.move(1, 1, 1);
+  EXPECT_EQ(6u, notifications.size());
+}
+
+TEST_F(ObservableVectorTest, BatchCoalescesAppends) {
+  vector.push_back(0);
+  notifications.clear();
+  vector.batch([this] {
+    for (int i = 1; i <= 1000; ++i) {
+      vector.push_back(i);
+    }
+  });
+  ASSERT_EQ(1u, notifications.size());
+  EXPECT_EQ(std::vector<Change>({{Change::kInsert, 1, 1000}}), last());
+}
+
+TEST_F(ObservableVectorTest, BatchCoalescesAdjacentEdits) {
+  vector.batch([this] {
+    for (int i = 0; i < 10; ++i) {
+      vector.push_back(i);
+    }
+  });
+  notifications.clear();
+
+  vector.batch([this] {
+    // Erasing forwards and backwards.
+    vector.erase(4);
+    vector.erase(4);
+    vector.erase(3);
+    // Replacing a run.
+    vector.set(0, 10);
+    vector.set(1, 11);
+    vector.set(0, 12);
+    // Inserting, then editing what was inserted.
+    vector.insert(2, 20);
+    vector.insert(3, 21);
+    vector.insert(2, 22);
+    vector.set(3, 23);
+    vector.erase(2);
+  });
+  ASSERT_EQ(1u, notifications.size());
+  EXPECT_EQ(std::vector<Change>({{Change::kErase, 3, 3},
+                                 {Change::kReplace, 0, 2},
+                                 {Change::kInsert, 2, 2}}),
+            last());
+  EXPECT_EQ(std::vector<int>({12, 11, 23, 21, 2, 6, 7, 8, 9}),
+            vector.values());
+}
+
+TEST_F(ObservableVectorTest, BatchInsertErasedAgain) {
+  vector.batch([this] {
+    vector.push_back(1);
+    vector.push_back(2);
+    vector.clear();
+  });
+  EXPECT_TRUE(notifications.empty());
+}
+
+TEST_F(ObservableVectorTest, NestedBatch) {
+  vector.batch([this] {
+    vector.push_back(1);
+    vector.batch([this] { vector.push_back(2); });
+    EXPECT_TRUE(notifications.empty());
+    vector.move(0, 1, 1);
+  });
+  ASSERT_EQ(1u, notifications.size());
+  EXPECT_EQ(std::vector<Change>(
+                {{Change::kInsert, 0, 2}, {Change::kMove, 0, 1, 1}}),
+            last());
+}
+
+TEST_F(ObservableVectorTest, BatchDeliversOnException) {
+  EXPECT_THROW(vector.batch([this] {
+    vector.push_back(1);
+    throw std::runtime_error("feed");
+  }),
+               std::runtime_error);
+  EXPECT_EQ(std::vector<Change>({{Change::kInsert, 0, 1}}), last());
+}
+
+const int kUnknown = -1;
+
+TEST_F(ObservableVectorTest, ReplayDeltas) {
+  // A consumer that only applies deltas: inserted and replaced slots are
+  // marked unknown, every other element must end up where the vector has it.
+  std::vector<int> mirror;
+  vector.collectionChanged().addHandler(
+      [&mirror](Object*, CollectionChangedEventArgs* args) {
+        for (const auto& change : args->changes()) {
+          auto first = mirror.begin() + change.offset;
+          switch (change.kind) {
+            case Change::kInsert:
+              mirror.insert(first, change.count, kUnknown);
+              break;
+            case Change::kErase:
+              mirror.erase(first, first + change.count);
+              break;
+            case Change::kReplace:
+              std::fill_n(first, change.count, kUnknown);
+              break;
+            case Change::kMove: {
+              std::vector<int> moved(first, first + change.count);
+              mirror.erase(first, first + change.count);
+              mirror.insert(mirror.begin() + change.destination,
+                            moved.begin(), moved.end());
+              break;
+            }
+          }
+        }
+      });
+  vector.batch([this] {
+    for (int i = 0; i < 20; ++i) {
+      vector.push_back(i);
+    }
+  });
+  EXPECT_EQ(std::vector<int>(20, kUnknown), mirror);
+  mirror = vector.values();
+
+  vector.batch([this] {
+    vector.erase(5, 3);
+    vector.set(1, 100);
+    vector.move(10, 2, 0);
+    vector.insert(4, 200);
+    vector.move(0, 3, 5);
+    vector.pop_back();
+    vector.erase(0);
+  });
+  ASSERT_EQ(vector.size(), mirror.size());
+  int unknown = 0;
+  for (std::size_t i = 0; i < mirror.size(); ++i) {
+    if (mirror[i] == kUnknown) {
+      ++unknown;
+    } else {
+      EXPECT_EQ(vector[i], mirror[i]) << i;
+    }
+  }
+  EXPECT_EQ(1, unknown);
+}
+
+}  // namespace
@@ -0,0 +1,145 @@
+#include <core/property.h>
+#include <core/property_store.h>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "allocation_counter.h"
+
+namespace {
+
+using namespace yuki;
+using Clock = std::chrono::steady_clock;
+
+template <typename F>
+double measure(int iterations, F&& f) {
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    f(i);
+  }
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+  return elapsed.count();
+}
+
+void report(const char* name, int iterations, std::size_t nodes,
+            double seconds) {
+  std::printf("%-24s %10.1f ns/write %10.2f M nodes/s\n", name,
+              seconds * 1e9 / iterations,
+              nodes * static_cast<double>(iterations) / seconds / 1e6);
+}
+
+void chain(int length, int iterations) {
+  std::vector<Property<int>> properties(length);
+  for (int i = 1; i < length; ++i) {
+    properties[i].bind(properties[i - 1]);
+  }
+  auto seconds = measure(iterations, [&](int i) { properties[0] = i; });
+  report("chain", iterations, length - 1, seconds);
+}
+
+void fanOut(int width, int iterations) {
+  Property<int> source;
+  std::vector<std::unique_ptr<Property<int>>> properties;
+  for (int i = 0; i < width; ++i) {
+    properties.emplace_back(std::make_unique<Property<int>>());
+    properties.back()->bind([&source, i] { return source + i; }, source);
+  }
+  auto seconds = measure(iterations, [&](int i) { source = i; });
+  report("fan-out", iterations, width, seconds);
+}
+
+void fanOutExpression(int width, int iterations) {
+  Property<int> source;
+  std::vector<std::unique_ptr<Property<int>>> properties;
+  for (int i = 0; i < width; ++i) {
+    properties.emplace_back(std::make_unique<Property<int>>());
+    properties.back()->bind(source + i);
+  }
+  auto seconds = measure(iterations, [&](int i) { source = i; });
+  report("fan-out (expression)", iterations, width, seconds);
+}
+
+void diamonds(int layers, int iterations) {
+  // a -> (b, c) -> d, repeated so that every layer feeds the next one.
+  std::vector<Property<int>> properties(layers * 3 + 1);
+  for (int i = 0; i < layers; ++i) {
+    auto& a = properties[i * 3];
+    auto& b = properties[i * 3 + 1];
+    auto& c = properties[i * 3 + 2];
+    auto& d = properties[i * 3 + 3];
+    b.bind([&a] { return a + 1; }, a);
+    c.bind([&a] { return a - 1; }, a);
+    d.bind([&b, &c] { return (b + c) / 2; }, b, c);
+  }
+  auto seconds = measure(iterations, [&](int i) { properties[0] = i; });
+  report("diamonds", iterations, properties.size() - 1, seconds);
+}
+
+void memory(int count) {
+  std::printf("%-24s %10zu bytes\n", "sizeof(Property<int>)",
+              sizeof(Property<int>));
+
+  std::vector<Property<int>> sources(count);
+  std::vector<Property<int>> properties(count);
+  auto allocationsBefore = allocations;
+  auto bytesBefore = allocatedBytes;
+  for (int i = 0; i < count; ++i) {
+    auto& a = sources[i];
+    auto& b = sources[(i + 1) % count];
+    auto& c = sources[(i + 2) % count];
+    properties[i].bind([&a, &b, &c] { return a + b + c; }, a, b, c);
+  }
+  std::printf("%-24s %10.3f allocations, %.1f bytes\n", "per bind (3 edges)",
+              static_cast<double>(allocations - allocationsBefore) / count,
+              static_cast<double>(allocatedBytes - bytesBefore) / count);
+}
+
+// |count| elements with 30 properties each, of which |local| are set.
+void store(int count, int local) {
+  constexpr int kProperties = 30;
+  struct DenseElement {
+    Property<float> properties[kProperties];
+  };
+  static std::vector<std::unique_ptr<PropertyDescriptor<float>>> descriptors;
+  for (int i = descriptors.size(); i < kProperties; ++i) {
+    descriptors.emplace_back(
+        std::make_unique<PropertyDescriptor<float>>("property", 1.f));
+  }
+
+  auto bytesBefore = allocatedBytes;
+  {
+    std::vector<DenseElement> elements(count);
+    for (auto& element : elements) {
+      for (int i = 0; i < local; ++i) {
+        element.properties[i] = 2.f;
+      }
+    }
+    std::printf("%-24s %10.1f bytes/element\n", "dense (30 properties)",
+                static_cast<double>(allocatedBytes - bytesBefore) / count);
+  }
+
+  bytesBefore = allocatedBytes;
+  std::vector<PropertyStore> elements(count);
+  for (auto& element : elements) {
+    for (int i = 0; i < local; ++i) {
+      element.set(*descriptors[i], 2.f);
+    }
+  }
+  char name[32];
+  std::snprintf(name, sizeof(name), "sparse (%d set)", local);
+  std::printf("%-24s %10.1f bytes/element\n", name,
+              static_cast<double>(allocatedBytes - bytesBefore) / count);
+}
+
+}  // namespace
+
+int main() {
+  memory(100000);
+  store(100000, 1);
+  store(100000, 3);
+  chain(100000, 100);
+  fanOut(10000, 1000);
+  fanOutExpression(10000, 1000);
+  diamonds(10000, 100);
+  return 0;
+}
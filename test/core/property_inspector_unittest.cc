@@ -0,0 +1,118 @@
+#include <core/property_inspector.h>
+#include <gtest/gtest.h>
+
+#if YUKI_PROPERTY_STATS
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace yuki;
+
+TEST(PropertyInspector, NodeStats) {
+  Property<int> a = 1;
+  Property<int> b;
+  Property<int> c;
+  a.setName("a");
+  b.bind([&a] { return a + 1; }, a);
+  c.bind([&a] { return a * 2; }, a);
+  PropertyInspector::resetCounters();
+
+  a = 2;
+  a = 3;
+  auto stats = PropertyInspector::stats(a);
+  EXPECT_EQ("a", stats.name);
+  EXPECT_EQ(2u, stats.fanOut);
+  EXPECT_EQ(0u, stats.fanIn);
+  EXPECT_EQ(0u, stats.evaluations);
+  stats = PropertyInspector::stats(b);
+  EXPECT_EQ(1u, stats.fanIn);
+  EXPECT_EQ(2u, stats.evaluations);
+
+  auto nodes = PropertyInspector::nodes();
+  auto live = [&nodes](const PropertyBase& property) {
+    return std::any_of(nodes.begin(), nodes.end(),
+                       [&property](const PropertyNodeStats& node) {
+                         return node.property == &property;
+                       });
+  };
+  EXPECT_TRUE(live(a));
+  EXPECT_TRUE(live(c));
+  {
+    Property<int> d;
+    nodes = PropertyInspector::nodes();
+    EXPECT_TRUE(live(d));
+  }
+  auto count = nodes.size();
+  nodes = PropertyInspector::nodes();
+  EXPECT_EQ(count - 1, nodes.size());
+}
+
+TEST(PropertyInspector, Cascade) {
+  // a -> b -> c -> d, a -> e (lazy)
+  Property<int> a;
+  Property<int> b;
+  Property<int> c;
+  Property<int> d;
+  Property<int> e;
+  b.bind([&a] { return a + 1; }, a);
+  c.bind([&b] { return b + 1; }, b);
+  d.bind([&c] { return c / 100; }, c);
+  e.setLazy(true);
+  e.bind([&a] { return a * 2; }, a);
+  e.get();
+
+  std::vector<PropertyCascadeStats> cascades;
+  PropertyInspector::setCascadeHandler(
+      [&cascades](const PropertyCascadeStats& cascade) {
+        cascades.push_back(cascade);
+      });
+  a = 1;
+  ASSERT_EQ(1u, cascades.size());
+  EXPECT_EQ(1u, cascades[0].sources);
+  EXPECT_EQ(5u, cascades[0].touched);
+  EXPECT_EQ(3u, cascades[0].evaluated);
+  // d stays 0.
+  EXPECT_EQ(2u, cascades[0].changed);
+  EXPECT_EQ(3u, cascades[0].depth);
+
+  PropertyBase::batch([&] {
+    a = 2;
+    c = 5;
+  });
+  ASSERT_EQ(2u, cascades.size());
+  EXPECT_EQ(2u, cascades[1].sources);
+  PropertyInspector::setCascadeHandler(nullptr);
+  EXPECT_EQ(cascades[1].evaluated, PropertyInspector::lastCascade().evaluated);
+}
+
+TEST(PropertyInspector, Dump) {
+  Property<int> a;
+  Property<int> b;
+  a.setName("source \"a\"");
+  b.setName("b");
+  b.bind(a);
+  PropertyInspector::resetCounters();
+
+  std::ostringstream dot;
+  PropertyInspector::dumpDot(dot);
+  EXPECT_NE(std::string::npos, dot.str().find("digraph properties {"));
+  // The label is a DOT string: quotes are escaped and \n breaks the line.
+  EXPECT_NE(std::string::npos,
+            dot.str().find("  n0 [label=\"b\\n0 evals, 0 us\"];\n"));
+  EXPECT_NE(std::string::npos,
+            dot.str().find(
+                "  n1 [label=\"source \\\"a\\\"\\n0 evals, 0 us\"];\n"));
+  // b was created last, so it is n0 and a is n1.
+  EXPECT_NE(std::string::npos, dot.str().find("n1 -> n0;"));
+
+  std::ostringstream json;
+  PropertyInspector::dumpJson(json);
+  EXPECT_EQ(0u, json.str().find("{\"nodes\": [{\"id\": 0, \"name\": \"b\""));
+  EXPECT_NE(std::string::npos, json.str().find("[1, 0]"));
+}
+
+}  // namespace
+#endif
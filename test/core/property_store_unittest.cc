@@ -0,0 +1,84 @@
+#include <core/property_store.h>
+#include <gtest/gtest.h>
+#include <string>
+
+namespace {
+
+using namespace yuki;
+
+class Element : public PropertyStore {
+ public:
+  static const PropertyDescriptor<float> kWidth;
+  static const PropertyDescriptor<float> kHeight;
+  static const PropertyDescriptor<std::string> kText;
+};
+
+const PropertyDescriptor<float> Element::kWidth("width", 100.f);
+const PropertyDescriptor<float> Element::kHeight("height", 20.f);
+const PropertyDescriptor<std::string> Element::kText("text");
+
+TEST(PropertyStore, Defaults) {
+  Element element;
+  EXPECT_EQ(100.f, element.get(Element::kWidth));
+  EXPECT_EQ("", element.get(Element::kText));
+  EXPECT_EQ(0u, element.size());
+  EXPECT_NE(Element::kWidth.id(), Element::kHeight.id());
+  EXPECT_STREQ("width", Element::kWidth.name());
+
+  element.set(Element::kText, "hello");
+  EXPECT_EQ("hello", element.get(Element::kText));
+  EXPECT_TRUE(element.has(Element::kText));
+  EXPECT_FALSE(element.has(Element::kWidth));
+  EXPECT_EQ(1u, element.size());
+
+  element.clear(Element::kText);
+  EXPECT_EQ("", element.get(Element::kText));
+  EXPECT_EQ(0u, element.size());
+}
+
+TEST(PropertyStore, Binding) {
+  Element parent;
+  Element child;
+  child.bind(Element::kWidth,
+             [&parent] { return parent.get(Element::kWidth) - 10; },
+             parent.property(Element::kWidth));
+  EXPECT_EQ(90.f, child.get(Element::kWidth));
+  parent.set(Element::kWidth, 50.f);
+  EXPECT_EQ(40.f, child.get(Element::kWidth));
+
+  // Observed entries are reset, not dropped.
+  parent.clear(Element::kWidth);
+  EXPECT_TRUE(parent.has(Element::kWidth));
+  EXPECT_EQ(90.f, child.get(Element::kWidth));
+
+  child.clear(Element::kWidth);
+  EXPECT_FALSE(child.has(Element::kWidth));
+  parent.set(Element::kWidth, 0.f);
+  EXPECT_EQ(100.f, child.get(Element::kWidth));
+}
+
+TEST(PropertyStore, TrackedRead) {
+  Element element;
+  Property<float> area;
+  area.bindTracked([&element] {
+    return element.get(Element::kWidth) * element.get(Element::kHeight);
+  });
+  EXPECT_EQ(2000.f, area.get());
+  EXPECT_EQ(2u, element.size());
+  element.set(Element::kHeight, 30.f);
+  EXPECT_EQ(3000.f, area.get());
+}
+
+TEST(PropertyStore, DestroyObservedStore) {
+  Property<float> width;
+  {
+    Element element;
+    element.set(Element::kWidth, 5.f);
+    width.bind(element.property(Element::kWidth));
+    EXPECT_EQ(5.f, width.get());
+  }
+  width = 7.f;
+  EXPECT_EQ(7.f, width.get());
+}
+
+}  // namespace
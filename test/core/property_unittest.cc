@@ -1,7 +1,11 @@
 #include <core/property.h>
 #include <gtest/gtest.h>
+#include <cmath>
 #include <cstdio>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 
 namespace {
 
@@ -110,4 +114,595 @@ TEST(Property, Rebind) {
   EXPECT_EQ(9, a.get());
 }
 
+TEST(Property, Diamond) {
+  Property<int> a = 1;
+  Property<int> b;
+  Property<int> c;
+  Property<int> d;
+  int evaluations = 0;
+  std::vector<int> seen;
+
+  b.bind([&] { return a + 1; }, a);
+  c.bind([&] { return a * 2; }, a);
+  d.bind(
+      [&] {
+        ++evaluations;
+        seen.push_back(b + c);
+        return b + c;
+      },
+      b, c);
+  EXPECT_EQ(2 + 2, d.get());
+
+  evaluations = 0;
+  seen.clear();
+  a = 10;
+  EXPECT_EQ(1, evaluations);
+  EXPECT_EQ(std::vector<int>{11 + 20}, seen);
+  EXPECT_EQ(31, d.get());
+}
+
+TEST(Property, FanOut) {
+  Property<int> a = 0;
+  Property<int> sum;
+  std::vector<std::unique_ptr<Property<int>>> dependents;
+  for (int i = 0; i < 1000; ++i) {
+    dependents.emplace_back(std::make_unique<Property<int>>());
+    dependents.back()->bind([&a, i] { return a + i; }, a);
+  }
+
+  a = 1;
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(1 + i, dependents[i]->get());
+  }
+
+  int evaluations = 0;
+  sum.bind(
+      [&] {
+        ++evaluations;
+        return dependents.front()->get() + dependents.back()->get();
+      },
+      *dependents.front(), *dependents.back());
+  evaluations = 0;
+  a = 2;
+  EXPECT_EQ(1, evaluations);
+  EXPECT_EQ(2 + 1001, sum.get());
+}
+
+TEST(Property, WriteInsideBinding) {
+  Property<int> a = 1;
+  Property<int> b;
+  Property<int> mirror;
+  Property<int> c;
+
+  c.bind([&] { return mirror * 10; }, mirror);
+  b.bind(
+      [&] {
+        mirror = a.get();
+        return a + 1;
+      },
+      a);
+  EXPECT_EQ(2, b.get());
+  EXPECT_EQ(10, c.get());
+
+  a = 5;
+  EXPECT_EQ(6, b.get());
+  EXPECT_EQ(50, c.get());
+}
+
+TEST(Property, DeepChain) {
+  constexpr int kLength = 1000000;
+  std::vector<Property<int>> chain(kLength);
+  for (int i = 1; i < kLength; ++i) {
+    chain[i].bind(chain[i - 1]);
+  }
+
+  chain[0] = 7;
+  EXPECT_EQ(7, chain[kLength - 1].get());
+  chain[0] = 8;
+  EXPECT_EQ(8, chain[kLength / 2].get());
+  EXPECT_EQ(8, chain[kLength - 1].get());
+}
+
+TEST(Property, DetachedCycle) {
+  std::vector<PropertyBase*> cycles;
+  PropertyBase::setCycleHandler(
+      [&](PropertyBase* property) { cycles.push_back(property); });
+
+  Property<int> s = 0;
+  Property<int> x;
+  Property<int> z;
+  Property<int> y;
+  int evaluations = 0;
+  y.bind(
+      [&] {
+        ++evaluations;
+        return s + z;
+      },
+      s, z);
+  x.bind([&] { return std::max<int>(s, z); }, s, z);
+  z.bind([&] { return x.get(); }, x);
+  EXPECT_TRUE(cycles.empty());
+
+  evaluations = 0;
+  s = 4;
+  EXPECT_EQ(1u, cycles.size());
+  EXPECT_TRUE(cycles[0] == &x || cycles[0] == &z);
+  EXPECT_EQ(1, evaluations);
+  EXPECT_EQ(4, z.get());
+  EXPECT_EQ(8, y.get());
+
+  // A cycle through the written property is a two-way binding, not an error.
+  cycles.clear();
+  x = 5;
+  EXPECT_TRUE(cycles.empty());
+  EXPECT_EQ(5, z.get());
+
+  PropertyBase::setCycleHandler(nullptr);
+}
+
+TEST(Property, Batch) {
+  Property<int> a = 1;
+  Property<int> b = 2;
+  Property<int> c;
+  int evaluations = 0;
+  std::vector<int> seen;
+  c.bind(
+      [&] {
+        ++evaluations;
+        seen.push_back(a + b);
+        return a + b;
+      },
+      a, b);
+
+  evaluations = 0;
+  seen.clear();
+  {
+    PropertyBatch batch;
+    a = 10;
+    b = 20;
+    a = 30;
+    EXPECT_EQ(0, evaluations);
+    EXPECT_EQ(3, c.get());
+  }
+  EXPECT_EQ(1, evaluations);
+  EXPECT_EQ(std::vector<int>{50}, seen);
+
+  evaluations = 0;
+  PropertyBase::batch([&] {
+    a = 1;
+    b = 1;
+  });
+  EXPECT_EQ(1, evaluations);
+  EXPECT_EQ(2, c.get());
+}
+
+TEST(Property, BatchRepeatedWrite) {
+  Property<int> a = 1;
+  Property<int> l;
+  Property<int> e;
+  l.bind([&] { return a * 10; }, a);
+  e.bind([&] { return l + a; }, l, a);
+  EXPECT_EQ(11, e.get());
+
+  {
+    PropertyBatch batch;
+    a = 4;
+    a = 1;
+  }
+  EXPECT_EQ(10, l.get());
+  EXPECT_EQ(11, e.get());
+
+  PropertyBase::batch([&] {
+    a = 2;
+    a = 3;
+    a = 3;
+  });
+  EXPECT_EQ(30, l.get());
+  EXPECT_EQ(33, e.get());
+}
+
+TEST(Property, NestedBatch) {
+  Property<int> a = 1;
+  Property<int> b = 2;
+  Property<int> c;
+  int evaluations = 0;
+  c.bind(
+      [&] {
+        ++evaluations;
+        return a * b;
+      },
+      a, b);
+
+  evaluations = 0;
+  {
+    PropertyBatch outer;
+    a = 3;
+    {
+      PropertyBatch inner;
+      b = 4;
+    }
+    EXPECT_EQ(0, evaluations);
+    EXPECT_EQ(2, c.get());
+  }
+  EXPECT_EQ(1, evaluations);
+  EXPECT_EQ(12, c.get());
+}
+
+TEST(Property, BatchCommitsOnUnwind) {
+  Property<int> a = 1;
+  Property<int> b;
+  b.bind([&] { return a * 2; }, a);
+
+  EXPECT_THROW(
+      {
+        PropertyBatch batch;
+        a = 5;
+        throw std::runtime_error("model update failed");
+      },
+      std::runtime_error);
+  EXPECT_EQ(10, b.get());
+
+  // The engine is usable again after the aborted scope.
+  a = 6;
+  EXPECT_EQ(12, b.get());
+}
+
+TEST(Property, BatchWithThrowingBinding) {
+  Property<int> a = 1;
+  Property<int> b;
+  Property<int> c;
+  b.bind(
+      [&]() -> int {
+        if (a < 0) throw std::invalid_argument("negative");
+        return a.get();
+      },
+      a);
+  c.bind([&] { return a + 1; }, a);
+
+  EXPECT_THROW(PropertyBase::batch([&] { a = -1; }), std::invalid_argument);
+  a = 3;
+  EXPECT_EQ(3, b.get());
+  EXPECT_EQ(4, c.get());
+}
+
+TEST(Property, Lazy) {
+  Property<int> a = 1;
+  Property<int> b;
+  Property<int> c;
+  int evaluations = 0;
+  b.setLazy(true);
+  c.setLazy(true);
+  b.bind(
+      [&] {
+        ++evaluations;
+        return a * 2;
+      },
+      a);
+  c.bind([&] { return b + 1; }, b);
+  EXPECT_EQ(0, evaluations);
+  EXPECT_TRUE(b.isDirty());
+
+  a = 2;
+  a = 3;
+  EXPECT_EQ(0, evaluations);
+  EXPECT_EQ(7, c.get());
+  EXPECT_EQ(1, evaluations);
+  EXPECT_FALSE(b.isDirty());
+  EXPECT_EQ(6, b.get());
+  EXPECT_EQ(1, evaluations);
+
+  a = 4;
+  EXPECT_TRUE(b.isDirty());
+  EXPECT_TRUE(c.isDirty());
+  b.setLazy(false);
+  EXPECT_FALSE(b.isDirty());
+  EXPECT_EQ(2, evaluations);
+  EXPECT_EQ(9, c.get());
+}
+
+TEST(Property, EagerObserverOfLazy) {
+  Property<int> a = 1;
+  Property<int> b;
+  Property<int> c;
+  b.setLazy(true);
+  b.bind([&] { return a + 1; }, a);
+  c.bind([&] { return b * 10; }, b);
+  EXPECT_EQ(20, c.get());
+
+  a = 5;
+  EXPECT_FALSE(b.isDirty());
+  EXPECT_EQ(60, c.get());
+}
+
+TEST(Property, LazyDeepChain) {
+  constexpr int kLength = 100000;
+  std::vector<Property<int>> chain(kLength);
+  for (int i = 1; i < kLength; ++i) {
+    chain[i].setLazy(true);
+    chain[i].bind(chain[i - 1]);
+  }
+
+  chain[0] = 3;
+  EXPECT_TRUE(chain[kLength - 1].isDirty());
+  EXPECT_EQ(3, chain[kLength - 1].get());
+  EXPECT_FALSE(chain[1].isDirty());
+}
+
+TEST(Property, UnbindOneOfMany) {
+  Property<int> a = 1;
+  std::vector<std::unique_ptr<Property<int>>> observers;
+  for (int i = 0; i < 5; ++i) {
+    observers.emplace_back(std::make_unique<Property<int>>());
+    observers.back()->bind(a);
+  }
+
+  observers[2]->unbind();
+  observers[0].reset();
+  observers[4].reset();
+  a = 2;
+  EXPECT_EQ(2, observers[1]->get());
+  EXPECT_EQ(1, observers[2]->get());
+  EXPECT_EQ(2, observers[3]->get());
+}
+
+TEST(Property, DestroyDependency) {
+  auto a = std::make_unique<Property<int>>(1);
+  Property<int> b;
+  Property<int> c;
+  b.bind(*a);
+  c.bind([&] { return b * 2; }, b);
+  a.reset();
+  b = 3;
+  EXPECT_EQ(6, c.get());
+}
+
+TEST(Property, Copy) {
+  Property<int> a = 1;
+  Property<int> b;
+  b.bind(a);
+  Property<int> copy = b;
+  a = 2;
+  EXPECT_EQ(2, b.get());
+  EXPECT_EQ(1, copy.get());
+  copy = b;
+  EXPECT_EQ(2, copy.get());
+}
+
+TEST(Property, UnchangedWrite) {
+  Property<int> a = 1;
+  Property<int> b;
+  int evaluations = 0;
+  b.bind(
+      [&] {
+        ++evaluations;
+        return a * 2;
+      },
+      a);
+
+  evaluations = 0;
+  auto version = a.version();
+  a = 1;
+  EXPECT_EQ(0, evaluations);
+  EXPECT_EQ(version, a.version());
+  a = 2;
+  EXPECT_EQ(1, evaluations);
+  EXPECT_LT(version, a.version());
+}
+
+TEST(Property, ChangeCutoff) {
+  Property<int> a = 1;
+  Property<int> parity;
+  Property<int> c;
+  int evaluations = 0;
+  parity.bind([&] { return a % 2; }, a);
+  c.bind(
+      [&] {
+        ++evaluations;
+        return parity * 10;
+      },
+      parity);
+
+  evaluations = 0;
+  a = 3;
+  EXPECT_EQ(0, evaluations);
+  a = 4;
+  EXPECT_EQ(1, evaluations);
+  EXPECT_EQ(0, c.get());
+}
+
+TEST(Property, ChangedSince) {
+  Property<int> a = 1;
+  Property<int> b;
+  b.bind([&] { return a / 10; }, a);
+
+  auto frame = PropertyBase::currentVersion();
+  EXPECT_FALSE(a.changedSince(frame));
+  a = 5;
+  EXPECT_TRUE(a.changedSince(frame));
+  EXPECT_FALSE(b.changedSince(frame));
+  a = 12;
+  EXPECT_TRUE(b.changedSince(frame));
+  EXPECT_EQ(b.version(), PropertyBase::currentVersion());
+}
+
+struct Point {
+  int x;
+  int y;
+};
+
+struct NearlyEqual {
+  bool operator()(double a, double b) const { return std::abs(a - b) < 0.01; }
+};
+
+TEST(Property, EqualityPolicy) {
+  Property<Point> point = Point{1, 2};
+  Property<int> x;
+  int evaluations = 0;
+  x.bind(
+      [&] {
+        ++evaluations;
+        return point().x;
+      },
+      point);
+
+  // Without operator== every write counts as a change.
+  evaluations = 0;
+  point = Point{1, 2};
+  EXPECT_EQ(1, evaluations);
+
+  Property<double, NearlyEqual> d = 1.0;
+  Property<double> e;
+  e.bind(d);
+  auto version = e.version();
+  d = 1.001;
+  EXPECT_EQ(1.0, d.get());
+  EXPECT_EQ(version, e.version());
+  d = 2.0;
+  EXPECT_EQ(2.0, e.get());
+}
+
+TEST(Property, TrackedBinding) {
+  Property<bool> flag = true;
+  Property<int> a = 1;
+  Property<int> b = 2;
+  Property<int> c;
+  int evaluations = 0;
+  c.bindTracked([&] {
+    ++evaluations;
+    return flag ? a.get() : b.get();
+  });
+  EXPECT_TRUE(c.isTracked());
+  EXPECT_EQ(1, c.get());
+
+  evaluations = 0;
+  b = 20;
+  EXPECT_EQ(0, evaluations);
+  a = 10;
+  EXPECT_EQ(1, evaluations);
+  EXPECT_EQ(10, c.get());
+
+  flag = false;
+  EXPECT_EQ(20, c.get());
+  evaluations = 0;
+  a = 11;
+  EXPECT_EQ(0, evaluations);
+  b = 21;
+  EXPECT_EQ(1, evaluations);
+  EXPECT_EQ(21, c.get());
+
+  c.unbind();
+  EXPECT_FALSE(c.isTracked());
+  b = 22;
+  EXPECT_EQ(21, c.get());
+}
+
+TEST(Property, TrackedDependencyUpdatedLater) {
+  Property<int> s = 0;
+  Property<bool> positive;
+  Property<int> twice;
+  Property<int> n;
+  Property<int> m;
+  positive.bind([&] { return s > 0; }, s);
+  twice.bind([&] { return s * 2; }, s);
+  n.bindTracked([&] { return positive ? twice.get() : -1; });
+  m.bind([&] { return n + 1; }, n);
+  EXPECT_EQ(-1, n.get());
+
+  // |n| starts reading |twice| in the same run that updates it.
+  s = 3;
+  EXPECT_EQ(6, n.get());
+  EXPECT_EQ(7, m.get());
+  s = 4;
+  EXPECT_EQ(8, n.get());
+  EXPECT_EQ(9, m.get());
+}
+
+TEST(Property, TrackedLazyReads) {
+  Property<int> a = 1;
+  Property<int> lazy;
+  Property<int> b = 5;
+  Property<int> c;
+  lazy.setLazy(true);
+  lazy.bind([&] { return a + b; }, a, b);
+  c.bindTracked([&] { return lazy * 2; });
+  EXPECT_EQ(12, c.get());
+
+  // |c| depends on |lazy| only, not on what |lazy| reads.
+  a = 2;
+  EXPECT_EQ(14, c.get());
+  lazy.unbind();
+  a = 3;
+  EXPECT_EQ(14, c.get());
+}
+
+TEST(Property, Expression) {
+  Property<int> a = 1;
+  Property<int> b = 2;
+  Property<int> c;
+  c.bind(a + b * 2);
+  EXPECT_EQ(5, c.get());
+
+  a = 10;
+  EXPECT_EQ(14, c.get());
+  b = -1;
+  EXPECT_EQ(8, c.get());
+
+  Property<int> d;
+  d.bind(-(c - a) % 3);
+  EXPECT_EQ(-(8 - 10) % 3, d.get());
+  c.unbind();
+  c = 30;
+  EXPECT_EQ(-20 % 3, d.get());
+}
+
+TEST(Property, ExpressionLogic) {
+  Property<int> width = 0;
+  Property<float> opacity = 0.5f;
+  Property<bool> enabled = true;
+  Property<float> alpha;
+  Property<bool> visible;
+  alpha.bind(select(width > 0 && enabled, opacity, 0.0f));
+  visible.bind(!(alpha == 0.0f) || width >= 100);
+  EXPECT_EQ(0.0f, alpha.get());
+  EXPECT_FALSE(visible.get());
+
+  width = 10;
+  EXPECT_EQ(0.5f, alpha.get());
+  EXPECT_TRUE(visible.get());
+  enabled = false;
+  EXPECT_EQ(0.0f, alpha.get());
+  EXPECT_FALSE(visible.get());
+  width = 100;
+  EXPECT_TRUE(visible.get());
+}
+
+struct Size {
+  int width;
+  int height;
+  int area() const { return width * height; }
+};
+
+TEST(Property, ExpressionProjection) {
+  Property<Size> size = Size{2, 3};
+  Property<int> width;
+  Property<int> area;
+  width.bind(project(size, &Size::width));
+  area.bind(project(size, &Size::area) + 1);
+  EXPECT_EQ(2, width.get());
+  EXPECT_EQ(7, area.get());
+
+  size = Size{4, 5};
+  EXPECT_EQ(4, width.get());
+  EXPECT_EQ(21, area.get());
+}
+
+TEST(Property, ExpressionAsValue) {
+  Property<int> a = 3;
+  Property<int> b = 4;
+  int sum = a + b;
+  bool less = a < b;
+  EXPECT_EQ(7, sum);
+  EXPECT_TRUE(less);
+}
+
 }  // namespace
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include <core/dispatcher.h>
+#include <core/thread_safe_property.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace yuki;
+
+TEST(ThreadSafeProperty, AppliedOnDrain) {
+  ThreadSafeProperty<int> a = 1;
+  Property<int> b;
+  b.bind([&a] { return a * 2; }, a);
+
+  a.post(2);
+  EXPECT_EQ(1, a.get());
+  EXPECT_TRUE(PropertyUpdate::hasPending());
+  PropertyUpdate::applyPending();
+  EXPECT_FALSE(PropertyUpdate::hasPending());
+  EXPECT_EQ(2, a.get());
+  EXPECT_EQ(4, b.get());
+}
+
+TEST(ThreadSafeProperty, Coalescing) {
+  ThreadSafeProperty<int> a;
+  int evaluations = 0;
+  Property<int> b;
+  b.bind(
+      [&a, &evaluations] {
+        ++evaluations;
+        return a.get();
+      },
+      a);
+  evaluations = 0;
+
+  for (int i = 1; i <= 100; ++i) {
+    a.post(i);
+  }
+  PropertyUpdate::applyPending();
+  EXPECT_EQ(100, b.get());
+  EXPECT_EQ(1, evaluations);
+}
+
+TEST(ThreadSafeProperty, SingleBatch) {
+  ThreadSafeProperty<int> a;
+  ThreadSafeProperty<int> b;
+  int evaluations = 0;
+  Property<int> c;
+  c.bind(
+      [&a, &b, &evaluations] {
+        ++evaluations;
+        return a + b;
+      },
+      a, b);
+  evaluations = 0;
+
+  a.post(1);
+  b.post(2);
+  PropertyUpdate::applyPending();
+  EXPECT_EQ(3, c.get());
+  EXPECT_EQ(1, evaluations);
+}
+
+TEST(ThreadSafeProperty, DestroyedWhilePending) {
+  ThreadSafeProperty<int> a;
+  {
+    ThreadSafeProperty<int> b;
+    b.post(1);
+    a.post(2);
+  }
+  auto c = std::make_unique<ThreadSafeProperty<int>>();
+  c->post(3);
+  c.reset();
+  PropertyUpdate::applyPending();
+  EXPECT_EQ(2, a.get());
+  EXPECT_FALSE(PropertyUpdate::hasPending());
+}
+
+TEST(ThreadSafeProperty, ManyThreads) {
+  const int kThreads = 8;
+  const int kPosts = 10000;
+  std::vector<std::unique_ptr<ThreadSafeProperty<int>>> properties;
+  for (int i = 0; i < kThreads; ++i) {
+    properties.emplace_back(std::make_unique<ThreadSafeProperty<int>>());
+  }
+  Property<int> sum;
+  sum.bind([&properties] {
+    int result = 0;
+    for (auto& property : properties) result += *property;
+    return result;
+  }, *properties[0], *properties[1], *properties[2], *properties[3],
+     *properties[4], *properties[5], *properties[6], *properties[7]);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&properties, i] {
+      for (int j = 1; j <= kPosts; ++j) {
+        properties[i]->post(j);
+      }
+    });
+  }
+  // Drain concurrently with the producers; every value seen must be one of
+  // theirs, and the last drain must see the final values.
+  for (int i = 0; i < 1000; ++i) {
+    PropertyUpdate::applyPending();
+    for (auto& property : properties) {
+      EXPECT_LE(0, property->get());
+      EXPECT_GE(kPosts, property->get());
+    }
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  PropertyUpdate::applyPending();
+  EXPECT_EQ(kThreads * kPosts, sum.get());
+}
+
+TEST(ThreadSafeProperty, AppliedByMainLoop) {
+  const int kThreads = 4;
+  const int kPosts = 10000;
+  std::vector<std::unique_ptr<ThreadSafeProperty<int>>> properties;
+  for (int i = 0; i < kThreads; ++i) {
+    properties.emplace_back(std::make_unique<ThreadSafeProperty<int>>());
+  }
+  Property<int> sum;
+  sum.bind([&properties] {
+    int result = 0;
+    for (auto& property : properties) result += *property;
+    // Only reached once the last post of every producer has been applied.
+    if (result == kThreads * kPosts) Dispatcher::main().quit(5);
+    return result;
+  }, *properties[0], *properties[1], *properties[2], *properties[3]);
+
+  // Nothing is posted to the dispatcher itself; the property posts alone
+  // have to keep the loop going.
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&properties, i] {
+      for (int j = 1; j <= kPosts; ++j) {
+        properties[i]->post(j);
+      }
+    });
+  }
+  EXPECT_EQ(5, Dispatcher::main().run());
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_FALSE(PropertyUpdate::hasPending());
+  EXPECT_EQ(kThreads * kPosts, sum.get());
+}
+
+}  // namespace